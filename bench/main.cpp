@@ -0,0 +1,247 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../common/bench.h"
+#include "../common/cpu_math.h"
+#include "../lab1/bresenham.h"
+#include "../lab3/transform.h"
+#include "../lab4/mesh_pipeline.h"
+#include "../lab4/soft_rasterizer.h"
+#include "../lab5/tracer.h"
+
+// Горячие участки лабораторных без окна и GPU. Все входные данные строятся генератором
+// с фиксированным seed, поэтому контрольные суммы совпадают от запуска к запуску.
+#define BENCH_SEED 20240521u
+
+// Размеры сцены: small — быстрая проверка, medium — типичная нагрузка, huge — заведомо больше реальной
+enum SceneSize { SIZE_SMALL, SIZE_MEDIUM, SIZE_HUGE, SIZE_COUNT };
+const char* SIZE_NAMES[SIZE_COUNT] = {"small", "medium", "huge"};
+
+std::string filter;  // --filter: запускать только замеры, в имени которых есть эта подстрока
+
+bool selected(const std::string& name) {
+    return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+// lab1: окружности Брезенхэма в монохромный растр (точки за пределами растра отбрасываются)
+void benchCircles(BenchSuite& suite, SceneSize size) {
+    const int circleCounts[SIZE_COUNT] = {100, 1000, 10000};
+    const int maxRadius[SIZE_COUNT] = {50, 300, 2000};
+    const int rasterSize[SIZE_COUNT] = {800, 1024, 4096};
+    const std::string name = std::string("lab1/bresenham_circles/") + SIZE_NAMES[size];
+    if (!selected(name)) return;
+
+    const int side = rasterSize[size];
+    std::mt19937 rng(BENCH_SEED);
+    std::uniform_int_distribution<int> position(0, side - 1), radius(5, maxRadius[size]);
+    struct Circle { int x, y, r; };
+    std::vector<Circle> circles(size_t(circleCounts[size]));
+    size_t points = 0;
+    for (Circle& c : circles) {
+        c = {position(rng), position(rng), radius(rng)};
+        points += size_t(c.r * 0.7072 + 1) * 8;  // Шагов до диагонали, по 8 точек на шаг
+    }
+
+    std::vector<uint8_t> raster(size_t(side) * size_t(side));
+    suite.run(name, points, [&]() {
+        std::fill(raster.begin(), raster.end(), 0);
+        for (const Circle& c : circles) {
+            bresenhamCircle(c.x, c.y, c.r, [&](int x, int y) {
+                if (unsigned(x) < unsigned(side) && unsigned(y) < unsigned(side)) raster[size_t(y) * size_t(side) + size_t(x)] = 1;
+            });
+        }
+        size_t lit = 0;
+        for (uint8_t p : raster) lit += p;
+        return lit;
+    });
+}
+
+// lab3: построение матриц объектов для двух порядков преобразований
+void benchTransforms(BenchSuite& suite, SceneSize size) {
+    const size_t objectCounts[SIZE_COUNT] = {1000, 100000, 1000000};
+    const size_t count = objectCounts[size];
+
+    std::mt19937 rng(BENCH_SEED);
+    std::uniform_real_distribution<float> scale(0.1f, 4.0f), angle(-180.0f, 180.0f), offset(-50.0f, 50.0f);
+    std::vector<TransformParams> params(count);
+    for (TransformParams& p : params) {
+        p.scale = scale(rng);
+        p.rotationX = angle(rng);
+        p.rotationY = angle(rng);
+        p.rotationZ = angle(rng);
+        p.translateX = offset(rng);
+        p.translateY = offset(rng);
+        p.translateZ = offset(rng);
+    }
+    std::vector<Mat4> matrices(count);
+
+    const struct { const char* name; TransformOrder order; } orders[] = {
+        {"lab3/compose_srt/", ORDER_SCALE_ROTATE_TRANSLATE},
+        {"lab3/compose_trs/", ORDER_TRANSLATE_ROTATE_SCALE},
+        {"lab3/compose_rts/", {TransformOp::Rotate, TransformOp::Translate, TransformOp::Scale}},  // Общий путь без специализации
+    };
+    for (const auto& o : orders) {
+        const std::string name = std::string(o.name) + SIZE_NAMES[size];
+        if (!selected(name)) continue;
+        suite.run(name, count, [&]() {
+            composeTransforms(o.order, params.data(), matrices.data(), count);
+            double sum = 0.0;
+            for (const Mat4& m : matrices) sum += double(m.m[12]) + double(m.m[13]) + double(m.m[14]);
+            return sum;
+        });
+    }
+}
+
+// lab4: вершинный этап программного растеризатора и упаковка вершин для GPU
+void benchVertexProcessing(BenchSuite& suite, SceneSize size) {
+    const size_t vertexCounts[SIZE_COUNT] = {1000, 100000, 1000000};
+    const size_t count = vertexCounts[size];
+
+    std::mt19937 rng(BENCH_SEED);
+    std::uniform_real_distribution<float> coord(-10.0f, 10.0f), unit(0.0f, 1.0f), normal(-1.0f, 1.0f);
+    Mesh mesh;
+    mesh.vertices.resize(count);
+    for (RawVertex& v : mesh.vertices) {
+        for (int k = 0; k < 3; ++k) {
+            v.position[k] = coord(rng);
+            v.color[k] = unit(rng);
+            v.normal[k] = normal(rng);
+        }
+    }
+    mesh.indices.resize(count - count % 3);
+    for (size_t i = 0; i < mesh.indices.size(); ++i) mesh.indices[i] = uint32_t(i);
+
+    const Mat4 model = mat4Multiply(mat4Translate(0.5f, -1.0f, -2.0f), mat4Rotate(30.0f, 0.0f, 1.0f, 0.0f));
+    const Mat4 viewProjection = mat4Multiply(mat4Perspective(45.0f, 16.0f / 9.0f, 0.1f, 100.0f), mat4LookAt(0, 5, 25, 0, 0, 0, 0, 1, 0));
+    const Mat3 normalMatrix = mat4NormalMatrix(model);
+    std::vector<ClipVertex> transformed(count);
+
+    std::string name = std::string("lab4/transform_vertices/") + SIZE_NAMES[size];
+    if (selected(name)) {
+        suite.run(name, count, [&]() {
+            for (size_t i = 0; i < count; ++i) transformVertex(mesh.vertices[i], model, viewProjection, normalMatrix, transformed[i]);
+            double sum = 0.0;
+            for (const ClipVertex& v : transformed) sum += double(v.clip[3]);
+            return sum;
+        });
+    }
+
+    name = std::string("lab4/pack_mesh/") + SIZE_NAMES[size];
+    if (selected(name)) {
+        suite.run(name, count, [&]() {
+            PackedMesh packed = packMesh(mesh);
+            uint64_t sum = 0;
+            for (const PackedVertex& v : packed.vertices) sum += uint64_t(v.normal) + uint16_t(v.position[0]);
+            return double(sum);
+        });
+    }
+}
+
+// lab5: трассировка кадра. Малая сцена — сцена из lab5, остальные добавляют случайные сферы
+void benchTracer(BenchSuite& suite, SceneSize size) {
+    const int widths[SIZE_COUNT] = {160, 640, 1280};
+    const int heights[SIZE_COUNT] = {120, 480, 720};
+    const int extraSpheres[SIZE_COUNT] = {0, 13, 61};
+    const std::string name = std::string("lab5/trace_frame/") + SIZE_NAMES[size];
+    if (!selected(name)) return;
+
+    Scene scene;
+    scene.spheres = {
+        { glm::vec3(0.0f, 0.0f, -3.0f), 1.0f, glm::vec3(1.0f, 1.0f, 0.0f) },
+        { glm::vec3(2.0f, 0.0f, -3.0f), 1.0f, glm::vec3(0.0f, 0.8f, 0.8f) },
+        { glm::vec3(-2.0f, 0.0f, -3.0f), 1.0f, glm::vec3(0.9f, 0.0f, 0.9f) }
+    };
+    scene.planes = { { glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.5f, 0.5f, 0.5f) } };
+    scene.light = { glm::vec3(3.0f, 2.0f, -2.0f), glm::vec3(1.0f, 1.0f, 0.0f) };
+    scene.viewPos = glm::vec3(0.0f, 0.0f, 3.0f);
+
+    std::mt19937 rng(BENCH_SEED);
+    std::uniform_real_distribution<float> x(-6.0f, 6.0f), y(-0.7f, 3.0f), z(-12.0f, -4.0f), r(0.2f, 0.7f), c(0.1f, 1.0f);
+    for (int i = 0; i < extraSpheres[size]; ++i) scene.spheres.push_back({glm::vec3(x(rng), y(rng), z(rng)), r(rng), glm::vec3(c(rng), c(rng), c(rng))});
+
+    const int width = widths[size], height = heights[size];
+    std::vector<uint8_t> rgb;
+    suite.run(name, size_t(width) * size_t(height), [&]() {
+        traceTile(scene, width, height, 0, 0, width, height, rgb);
+        uint64_t sum = 0;
+        for (uint8_t b : rgb) sum += b;
+        return double(sum);
+    });
+}
+
+void printUsage() {
+    std::cout << "bench [--size small|medium|huge|all] [--filter text] [--warmup N] [--reps N] [--min-time ms]\n"
+                 "      [--json out.json] [--baseline base.json] [--threshold percent]\n";
+}
+
+int main(int argc, char** argv) {
+    int warmup = 2, repetitions = 10;
+    double threshold = 10.0;  // Допустимый рост минимального времени относительно базовой линии, %
+    double minSampleMs = 10.0; // Минимальная длительность одного повторения
+    std::string jsonPath, baselinePath;
+    bool sizes[SIZE_COUNT] = {true, true, false};  // huge — только по явному запросу
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            std::string value = argv[++i];
+            for (int s = 0; s < SIZE_COUNT; ++s) sizes[s] = value == "all" || value == SIZE_NAMES[s];
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            repetitions = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            minSampleMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baselinePath = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    BenchSuite suite(warmup, repetitions, minSampleMs);
+    if (!baselinePath.empty()) {
+        std::map<std::string, BenchBaseline> baseline;
+        if (!BenchSuite::loadBaseline(baselinePath, baseline)) {
+            std::cout << "Failed to read baseline " << baselinePath << std::endl;
+            return 2;
+        }
+        suite.setBaseline(baseline, threshold);
+    }
+    for (int s = 0; s < SIZE_COUNT; ++s) {
+        if (!sizes[s]) continue;
+        benchCircles(suite, SceneSize(s));
+        benchTransforms(suite, SceneSize(s));
+        benchVertexProcessing(suite, SceneSize(s));
+        benchTracer(suite, SceneSize(s));
+    }
+
+    if (!jsonPath.empty() && !suite.writeJson(jsonPath)) {
+        std::cout << "Failed to write " << jsonPath << std::endl;
+        return 2;
+    }
+
+    if (baselinePath.empty()) return 0;
+    int regressions = 0, mismatches = 0;
+    for (const BenchComparison& c : suite.compare()) {
+        std::printf("%-40s %10.3f -> %10.3f ms  %+7.1f%% (noise %.3f ms)%s%s\n", c.name.c_str(), c.baselineMs, c.currentMs,
+                    c.changePercent, c.noiseMs, c.regression ? "  REGRESSION" : "", c.checksumMismatch ? "  CHECKSUM MISMATCH" : "");
+        if (c.regression) regressions++;
+        if (c.checksumMismatch) mismatches++;
+    }
+    std::cout << regressions << " regression(s) above " << threshold << "%, " << mismatches << " checksum mismatch(es)" << std::endl;
+    return regressions > 0 || mismatches > 0 ? 1 : 0;
+}
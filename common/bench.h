@@ -0,0 +1,211 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Результат одного замера: статистика по повторениям, время одного вызова в миллисекундах
+struct BenchResult {
+    std::string name;
+    size_t items = 0;        // Сколько единиц работы (точек, вершин, пикселей) в одном вызове
+    int warmup = 0;
+    int repetitions = 0;
+    int callsPerSample = 1;  // Вызовов в одном повторении: короткие замеры повторяются до minSampleMs
+    double minMs = 0.0, medianMs = 0.0, meanMs = 0.0, stddevMs = 0.0, p90Ms = 0.0, maxMs = 0.0;
+    double checksum = 0.0;   // Результат последнего вызова: при фиксированных seed меняется только вместе с выводом
+};
+
+// Сохраненные значения одного замера из файла базовой линии
+struct BenchBaseline {
+    double minMs = 0.0;
+    double stddevMs = 0.0;
+    int repetitions = 1;
+    double checksum = 0.0;
+};
+
+// Сравнение с базовой линией по минимальному времени вызова
+struct BenchComparison {
+    std::string name;
+    double baselineMs = 0.0;
+    double currentMs = 0.0;
+    double changePercent = 0.0;
+    double noiseMs = 0.0;           // Граница шума: две совокупные стандартные ошибки
+    bool regression = false;
+    bool checksumMismatch = false;  // Результат работы изменился — это ошибка независимо от времени
+};
+
+// Набор замеров: прогрев, повторения, статистика, вывод в JSON и сверка с сохраненной базовой линией.
+// Функция замера возвращает число (контрольную сумму), чтобы компилятор не выбросил работу.
+// Повторение короче minSampleMs набирается несколькими вызовами: на долях миллисекунды
+// разрешение таймера и планировщик дают разброс в десятки процентов.
+class BenchSuite {
+public:
+    BenchSuite(int warmup, int repetitions, double minSampleMs = 10.0)
+        : warmup_(std::max(warmup, 1)), repetitions_(std::max(repetitions, 1)), minSampleMs_(std::max(minSampleMs, 0.0)) {}
+
+    // Базовая линия, заданная до замеров: замер, похожий на регрессию, сразу перемеряется до
+    // retries раз и остается лучший результат — кратковременная нагрузка на машину не валит прогон
+    void setBaseline(const std::map<std::string, BenchBaseline>& baseline, double thresholdPercent, int retries = 2) {
+        baseline_ = baseline;
+        thresholdPercent_ = thresholdPercent;
+        retries_ = std::max(retries, 0);
+    }
+
+    template <typename Fn>
+    const BenchResult& run(const std::string& name, size_t items, Fn&& fn) {
+        BenchResult result = measure(name, items, fn);
+        auto base = baseline_.find(name);
+        for (int attempt = 0; attempt < retries_ && base != baseline_.end() && compareWith(result, base->second).regression; ++attempt) {
+            std::printf("%-40s slower than baseline, measuring again\n", name.c_str());
+            BenchResult again = measure(name, items, fn);
+            if (again.minMs < result.minMs) result = again;
+        }
+
+        std::printf("%-40s min %10.3f ms  median %10.3f  p90 %10.3f  sd %8.3f  x%-6d %12.0f items/s\n", name.c_str(), result.minMs,
+                    result.medianMs, result.p90Ms, result.stddevMs, result.callsPerSample,
+                    result.minMs > 0.0 ? double(items) * 1000.0 / result.minMs : 0.0);
+        results_.push_back(result);
+        return results_.back();
+    }
+
+    const std::vector<BenchResult>& results() const { return results_; }
+
+    // Один объект на строку: файл читается loadBaseline и удобно сравнивается в diff
+    std::string toJson() const {
+        std::ostringstream out;
+        out.precision(17);
+        out << "{\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const BenchResult& r = results_[i];
+            out << "    {\"name\": \"" << r.name << "\", \"items\": " << r.items << ", \"warmup\": " << r.warmup
+                << ", \"repetitions\": " << r.repetitions << ", \"calls_per_sample\": " << r.callsPerSample << ", \"min_ms\": " << r.minMs << ", \"median_ms\": " << r.medianMs
+                << ", \"mean_ms\": " << r.meanMs << ", \"stddev_ms\": " << r.stddevMs << ", \"p90_ms\": " << r.p90Ms
+                << ", \"max_ms\": " << r.maxMs << ", \"checksum\": " << r.checksum << "}" << (i + 1 < results_.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+        return out.str();
+    }
+
+    bool writeJson(const std::string& path) const {
+        std::ofstream file(path);
+        if (!file) return false;
+        file << toJson();
+        return bool(file);
+    }
+
+    // Значения из файла, записанного writeJson: имя замера -> min_ms, stddev_ms, repetitions, checksum
+    static bool loadBaseline(const std::string& path, std::map<std::string, BenchBaseline>& baseline) {
+        std::ifstream file(path);
+        if (!file) return false;
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        const std::string text = buffer.str();
+
+        size_t pos = 0;
+        while ((pos = text.find("\"name\"", pos)) != std::string::npos) {
+            const size_t objectEnd = text.find('}', pos);
+            const size_t nameStart = text.find('"', text.find(':', pos) + 1);
+            const size_t nameEnd = text.find('"', nameStart + 1);
+            if (objectEnd == std::string::npos || nameEnd == std::string::npos) return false;
+            auto number = [&](const char* key, double& value) {
+                const size_t at = text.find(std::string("\"") + key + "\"", pos);
+                if (at == std::string::npos || at > objectEnd) return false;
+                value = std::strtod(text.c_str() + text.find(':', at) + 1, nullptr);
+                return true;
+            };
+            BenchBaseline entry;
+            double repetitions = 1.0;
+            if (!number("min_ms", entry.minMs) || !number("stddev_ms", entry.stddevMs) || !number("repetitions", repetitions) ||
+                !number("checksum", entry.checksum))
+                return false;
+            entry.repetitions = std::max(int(repetitions), 1);
+            baseline[text.substr(nameStart + 1, nameEnd - nameStart - 1)] = entry;
+            pos = objectEnd;
+        }
+        return true;
+    }
+
+    // Сравнение всех замеров с базовой линией из setBaseline; замеры без базовой линии пропускаются
+    std::vector<BenchComparison> compare() const {
+        std::vector<BenchComparison> comparisons;
+        for (const BenchResult& r : results_) {
+            auto it = baseline_.find(r.name);
+            if (it != baseline_.end() && it->second.minMs > 0.0) comparisons.push_back(compareWith(r, it->second));
+        }
+        return comparisons;
+    }
+
+private:
+    template <typename Fn>
+    BenchResult measure(const std::string& name, size_t items, Fn& fn) const {
+        using Clock = std::chrono::steady_clock;
+        volatile double sink = 0.0;
+        double warmupMs = 0.0;
+        for (int i = 0; i < warmup_; ++i) {
+            auto start = Clock::now();
+            sink = sink + double(fn());
+            warmupMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+        // Число вызовов в повторении — по последнему (уже прогретому) вызову
+        const int calls = warmupMs > 0.0 ? int(std::clamp(std::ceil(minSampleMs_ / warmupMs), 1.0, 1e6)) : 1;
+
+        std::vector<double> times(static_cast<size_t>(repetitions_));
+        double checksum = 0.0;
+        for (int i = 0; i < repetitions_; ++i) {
+            auto start = Clock::now();
+            for (int c = 0; c < calls; ++c) {
+                checksum = double(fn());
+                sink = sink + checksum;
+            }
+            times[size_t(i)] = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / calls;
+        }
+
+        BenchResult result;
+        result.name = name;
+        result.items = items;
+        result.warmup = warmup_;
+        result.repetitions = repetitions_;
+        result.callsPerSample = calls;
+        result.checksum = checksum;
+        std::sort(times.begin(), times.end());
+        const size_t n = times.size();
+        result.minMs = times.front();
+        result.maxMs = times.back();
+        result.medianMs = n % 2 == 1 ? times[n / 2] : 0.5 * (times[n / 2 - 1] + times[n / 2]);
+        result.p90Ms = times[std::min(n - 1, size_t(std::ceil(0.9 * double(n))) - 1)];
+        for (double t : times) result.meanMs += t;
+        result.meanMs /= double(n);
+        for (double t : times) result.stddevMs += (t - result.meanMs) * (t - result.meanMs);
+        result.stddevMs = n > 1 ? std::sqrt(result.stddevMs / double(n - 1)) : 0.0;
+        return result;
+    }
+
+    // Регрессия — минимальное время вызова выросло больше чем на порог и больше границы шума;
+    // контрольная сумма должна совпасть точно
+    BenchComparison compareWith(const BenchResult& r, const BenchBaseline& base) const {
+        BenchComparison c;
+        c.name = r.name;
+        c.baselineMs = base.minMs;
+        c.currentMs = r.minMs;
+        c.changePercent = base.minMs > 0.0 ? 100.0 * (r.minMs - base.minMs) / base.minMs : 0.0;
+        c.noiseMs = 2.0 * std::sqrt(base.stddevMs * base.stddevMs / base.repetitions + r.stddevMs * r.stddevMs / r.repetitions);
+        c.regression = c.changePercent > thresholdPercent_ && r.minMs - base.minMs > c.noiseMs;
+        c.checksumMismatch = r.checksum != base.checksum;
+        return c;
+    }
+
+    int warmup_;
+    int repetitions_;
+    double minSampleMs_;
+    std::map<std::string, BenchBaseline> baseline_;
+    double thresholdPercent_ = 10.0;
+    int retries_ = 0;
+    std::vector<BenchResult> results_;
+};
@@ -0,0 +1,295 @@
+#pragma once
+
+// Небольшая библиотека матричной математики на CPU для лабораторных 2-4.
+// Матрицы хранятся по столбцам, как в OpenGL и glm: их можно передавать
+// напрямую в glLoadMatrixf / glUniformMatrix4fv без транспонирования.
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CPU_MATH_USE_AVX 1
+#endif
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define CPU_MATH_USE_SSE 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CPU_MATH_USE_NEON 1
+#endif
+
+struct alignas(16) Vec4 {
+    float x, y, z, w;
+};
+
+// Матрица 4x4, хранится по столбцам (m[столбец * 4 + строка])
+struct alignas(16) Mat4 {
+    float m[16];
+};
+
+// Матрица 3x3 по столбцам (формат glUniformMatrix3fv), используется для нормалей
+struct Mat3 {
+    float m[9];
+};
+
+inline Mat4 mat4Identity() {
+    return Mat4{{1.0f, 0.0f, 0.0f, 0.0f,
+                 0.0f, 1.0f, 0.0f, 0.0f,
+                 0.0f, 0.0f, 1.0f, 0.0f,
+                 0.0f, 0.0f, 0.0f, 1.0f}};
+}
+
+// Произведение a * b (так же, как glMultMatrixf домножает текущую матрицу справа)
+inline Mat4 mat4Multiply(const Mat4& a, const Mat4& b) {
+    Mat4 r;
+#if defined(CPU_MATH_USE_SSE)
+    __m128 a0 = _mm_load_ps(a.m + 0);
+    __m128 a1 = _mm_load_ps(a.m + 4);
+    __m128 a2 = _mm_load_ps(a.m + 8);
+    __m128 a3 = _mm_load_ps(a.m + 12);
+    for (int j = 0; j < 4; ++j) {
+        const float* bc = b.m + j * 4;
+        __m128 col = _mm_mul_ps(a0, _mm_set1_ps(bc[0]));
+        col = _mm_add_ps(col, _mm_mul_ps(a1, _mm_set1_ps(bc[1])));
+        col = _mm_add_ps(col, _mm_mul_ps(a2, _mm_set1_ps(bc[2])));
+        col = _mm_add_ps(col, _mm_mul_ps(a3, _mm_set1_ps(bc[3])));
+        _mm_store_ps(r.m + j * 4, col);
+    }
+#elif defined(CPU_MATH_USE_NEON)
+    float32x4_t a0 = vld1q_f32(a.m + 0);
+    float32x4_t a1 = vld1q_f32(a.m + 4);
+    float32x4_t a2 = vld1q_f32(a.m + 8);
+    float32x4_t a3 = vld1q_f32(a.m + 12);
+    for (int j = 0; j < 4; ++j) {
+        const float* bc = b.m + j * 4;
+        float32x4_t col = vmulq_n_f32(a0, bc[0]);
+        col = vmlaq_n_f32(col, a1, bc[1]);
+        col = vmlaq_n_f32(col, a2, bc[2]);
+        col = vmlaq_n_f32(col, a3, bc[3]);
+        vst1q_f32(r.m + j * 4, col);
+    }
+#else
+    for (int j = 0; j < 4; ++j) {
+        for (int i = 0; i < 4; ++i) {
+            r.m[j * 4 + i] = a.m[i] * b.m[j * 4] + a.m[4 + i] * b.m[j * 4 + 1] +
+                             a.m[8 + i] * b.m[j * 4 + 2] + a.m[12 + i] * b.m[j * 4 + 3];
+        }
+    }
+#endif
+    return r;
+}
+
+inline Vec4 mat4Transform(const Mat4& m, const Vec4& v) {
+    Vec4 r;
+    r.x = m.m[0] * v.x + m.m[4] * v.y + m.m[8] * v.z + m.m[12] * v.w;
+    r.y = m.m[1] * v.x + m.m[5] * v.y + m.m[9] * v.z + m.m[13] * v.w;
+    r.z = m.m[2] * v.x + m.m[6] * v.y + m.m[10] * v.z + m.m[14] * v.w;
+    r.w = m.m[3] * v.x + m.m[7] * v.y + m.m[11] * v.z + m.m[15] * v.w;
+    return r;
+}
+
+// Пакетное умножение parent * models[i]
+inline void mat4MultiplyBatch(const Mat4& parent, const Mat4* models, Mat4* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = mat4Multiply(parent, models[i]);
+    }
+}
+
+// Пакетное преобразование вершин: out[i] = m * in[i]
+inline void mat4TransformBatch(const Mat4& m, const Vec4* in, Vec4* out, size_t count) {
+    size_t i = 0;
+#if defined(CPU_MATH_USE_AVX)
+    // Две вершины за итерацию: столбцы матрицы дублируются в обе половины 256-битного регистра
+    __m256 c0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m.m + 0));
+    __m256 c1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m.m + 4));
+    __m256 c2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m.m + 8));
+    __m256 c3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m.m + 12));
+    for (; i + 2 <= count; i += 2) {
+        __m256 v = _mm256_loadu_ps(&in[i].x);
+        __m256 r = _mm256_mul_ps(c0, _mm256_permute_ps(v, 0x00));
+        r = _mm256_add_ps(r, _mm256_mul_ps(c1, _mm256_permute_ps(v, 0x55)));
+        r = _mm256_add_ps(r, _mm256_mul_ps(c2, _mm256_permute_ps(v, 0xAA)));
+        r = _mm256_add_ps(r, _mm256_mul_ps(c3, _mm256_permute_ps(v, 0xFF)));
+        _mm256_storeu_ps(&out[i].x, r);
+    }
+#endif
+#if defined(CPU_MATH_USE_SSE)
+    __m128 s0 = _mm_load_ps(m.m + 0);
+    __m128 s1 = _mm_load_ps(m.m + 4);
+    __m128 s2 = _mm_load_ps(m.m + 8);
+    __m128 s3 = _mm_load_ps(m.m + 12);
+    for (; i < count; ++i) {
+        __m128 v = _mm_load_ps(&in[i].x);
+        __m128 r = _mm_mul_ps(s0, _mm_shuffle_ps(v, v, 0x00));
+        r = _mm_add_ps(r, _mm_mul_ps(s1, _mm_shuffle_ps(v, v, 0x55)));
+        r = _mm_add_ps(r, _mm_mul_ps(s2, _mm_shuffle_ps(v, v, 0xAA)));
+        r = _mm_add_ps(r, _mm_mul_ps(s3, _mm_shuffle_ps(v, v, 0xFF)));
+        _mm_store_ps(&out[i].x, r);
+    }
+#elif defined(CPU_MATH_USE_NEON)
+    float32x4_t n0 = vld1q_f32(m.m + 0);
+    float32x4_t n1 = vld1q_f32(m.m + 4);
+    float32x4_t n2 = vld1q_f32(m.m + 8);
+    float32x4_t n3 = vld1q_f32(m.m + 12);
+    for (; i < count; ++i) {
+        float32x4_t r = vmulq_n_f32(n0, in[i].x);
+        r = vmlaq_n_f32(r, n1, in[i].y);
+        r = vmlaq_n_f32(r, n2, in[i].z);
+        r = vmlaq_n_f32(r, n3, in[i].w);
+        vst1q_f32(&out[i].x, r);
+    }
+#else
+    for (; i < count; ++i) {
+        out[i] = mat4Transform(m, in[i]);
+    }
+#endif
+}
+
+inline Mat4 mat4Translate(float x, float y, float z) {
+    Mat4 r = mat4Identity();
+    r.m[12] = x;
+    r.m[13] = y;
+    r.m[14] = z;
+    return r;
+}
+
+inline Mat4 mat4Scale(float x, float y, float z) {
+    Mat4 r = mat4Identity();
+    r.m[0] = x;
+    r.m[5] = y;
+    r.m[10] = z;
+    return r;
+}
+
+// Поворот на угол в градусах вокруг оси (x, y, z), как у glRotatef
+inline Mat4 mat4Rotate(float angleDegrees, float x, float y, float z) {
+    float len = std::sqrt(x * x + y * y + z * z);
+    if (len == 0.0f) return mat4Identity();
+    x /= len;
+    y /= len;
+    z /= len;
+
+    float a = angleDegrees * 3.14159265358979f / 180.0f;
+    float c = std::cos(a), s = std::sin(a), t = 1.0f - c;
+
+    Mat4 r = mat4Identity();
+    r.m[0] = t * x * x + c;
+    r.m[1] = t * x * y + s * z;
+    r.m[2] = t * x * z - s * y;
+    r.m[4] = t * x * y - s * z;
+    r.m[5] = t * y * y + c;
+    r.m[6] = t * y * z + s * x;
+    r.m[8] = t * x * z + s * y;
+    r.m[9] = t * y * z - s * x;
+    r.m[10] = t * z * z + c;
+    return r;
+}
+
+// Перспективная проекция, как у gluPerspective (угол обзора по вертикали в градусах)
+inline Mat4 mat4Perspective(float fovyDegrees, float aspect, float zNear, float zFar) {
+    float f = 1.0f / std::tan(fovyDegrees * 3.14159265358979f / 360.0f);
+    Mat4 r = {};
+    r.m[0] = f / aspect;
+    r.m[5] = f;
+    r.m[10] = (zFar + zNear) / (zNear - zFar);
+    r.m[11] = -1.0f;
+    r.m[14] = 2.0f * zFar * zNear / (zNear - zFar);
+    return r;
+}
+
+// Видовая матрица, как у gluLookAt
+inline Mat4 mat4LookAt(float eyeX, float eyeY, float eyeZ,
+                       float centerX, float centerY, float centerZ,
+                       float upX, float upY, float upZ) {
+    float fx = centerX - eyeX, fy = centerY - eyeY, fz = centerZ - eyeZ;
+    float fl = std::sqrt(fx * fx + fy * fy + fz * fz);
+    fx /= fl; fy /= fl; fz /= fl;
+
+    // s = f x up
+    float sx = fy * upZ - fz * upY, sy = fz * upX - fx * upZ, sz = fx * upY - fy * upX;
+    float sl = std::sqrt(sx * sx + sy * sy + sz * sz);
+    sx /= sl; sy /= sl; sz /= sl;
+
+    // u = s x f
+    float ux = sy * fz - sz * fy, uy = sz * fx - sx * fz, uz = sx * fy - sy * fx;
+
+    Mat4 r = mat4Identity();
+    r.m[0] = sx;  r.m[4] = sy;  r.m[8] = sz;
+    r.m[1] = ux;  r.m[5] = uy;  r.m[9] = uz;
+    r.m[2] = -fx; r.m[6] = -fy; r.m[10] = -fz;
+    r.m[12] = -(sx * eyeX + sy * eyeY + sz * eyeZ);
+    r.m[13] = -(ux * eyeX + uy * eyeY + uz * eyeZ);
+    r.m[14] = fx * eyeX + fy * eyeY + fz * eyeZ;
+    return r;
+}
+
+// Обратная для аффинной матрицы [A t; 0 1]: [A^-1, -A^-1 t]. Дешевле общего обращения 4x4.
+inline Mat4 mat4AffineInverse(const Mat4& m) {
+    const float* a = m.m;
+    // Алгебраические дополнения верхнего блока 3x3
+    float c00 = a[5] * a[10] - a[9] * a[6];
+    float c01 = a[9] * a[2] - a[1] * a[10];
+    float c02 = a[1] * a[6] - a[5] * a[2];
+    float c10 = a[8] * a[6] - a[4] * a[10];
+    float c11 = a[0] * a[10] - a[8] * a[2];
+    float c12 = a[4] * a[2] - a[0] * a[6];
+    float c20 = a[4] * a[9] - a[8] * a[5];
+    float c21 = a[8] * a[1] - a[0] * a[9];
+    float c22 = a[0] * a[5] - a[4] * a[1];
+
+    float det = a[0] * c00 + a[4] * c01 + a[8] * c02;
+    float invDet = det != 0.0f ? 1.0f / det : 0.0f;
+
+    Mat4 r = mat4Identity();
+    r.m[0] = c00 * invDet; r.m[4] = c10 * invDet; r.m[8] = c20 * invDet;
+    r.m[1] = c01 * invDet; r.m[5] = c11 * invDet; r.m[9] = c21 * invDet;
+    r.m[2] = c02 * invDet; r.m[6] = c12 * invDet; r.m[10] = c22 * invDet;
+
+    r.m[12] = -(r.m[0] * a[12] + r.m[4] * a[13] + r.m[8] * a[14]);
+    r.m[13] = -(r.m[1] * a[12] + r.m[5] * a[13] + r.m[9] * a[14]);
+    r.m[14] = -(r.m[2] * a[12] + r.m[6] * a[13] + r.m[10] * a[14]);
+    return r;
+}
+
+// Матрица нормалей transpose(inverse(mat3(m))) для аффинной модельной матрицы
+inline Mat3 mat4NormalMatrix(const Mat4& m) {
+    Mat4 inv = mat4AffineInverse(m);
+    Mat3 r;
+    for (int col = 0; col < 3; ++col) {
+        for (int row = 0; row < 3; ++row) {
+            r.m[col * 3 + row] = inv.m[row * 4 + col];
+        }
+    }
+    return r;
+}
+
+// Стек матриц на CPU, заменяющий glPushMatrix / glPopMatrix.
+// Операции домножают вершину стека справа, как фиксированный конвейер OpenGL.
+class MatrixStack {
+public:
+    MatrixStack() { stack_.reserve(32); stack_.push_back(mat4Identity()); }
+
+    void push() { stack_.push_back(stack_.back()); }
+    void pop() { if (stack_.size() > 1) stack_.pop_back(); }
+
+    const Mat4& top() const { return stack_.back(); }
+
+    void loadIdentity() { stack_.back() = mat4Identity(); }
+    void load(const Mat4& m) { stack_.back() = m; }
+    void multiply(const Mat4& m) { stack_.back() = mat4Multiply(stack_.back(), m); }
+
+    void translate(float x, float y, float z) { multiply(mat4Translate(x, y, z)); }
+    void scale(float x, float y, float z) { multiply(mat4Scale(x, y, z)); }
+    void rotate(float angleDegrees, float x, float y, float z) { multiply(mat4Rotate(angleDegrees, x, y, z)); }
+
+    void lookAt(float eyeX, float eyeY, float eyeZ,
+                float centerX, float centerY, float centerZ,
+                float upX, float upY, float upZ) {
+        multiply(mat4LookAt(eyeX, eyeY, eyeZ, centerX, centerY, centerZ, upX, upY, upZ));
+    }
+
+private:
+    std::vector<Mat4> stack_;  // Mat4 выровнена по 16 байт, aligned new C++17 сохраняет выравнивание
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <SFML/Window.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <thread>
+
+// Гистограмма длительностей кадра по корзинам 1, 2, 4, 8, 16.7, 33.3, 50, 100 мс и больше
+class FrameTimeHistogram {
+public:
+    static constexpr int BUCKETS = 9;
+
+    void add(double ms) {
+        int bucket = 0;
+        while (bucket < BUCKETS - 1 && ms >= limits()[bucket]) ++bucket;
+        counts_[bucket]++;
+        count_++;
+        total_ += ms;
+        min_ = count_ == 1 ? ms : std::min(min_, ms);
+        max_ = std::max(max_, ms);
+    }
+
+    size_t count() const { return count_; }
+    double average() const { return count_ > 0 ? total_ / double(count_) : 0.0; }
+
+    std::string report(const char* name) const {
+        char line[128];
+        std::snprintf(line, sizeof(line), "%s: %zu frames, avg %.3f ms, min %.3f ms, max %.3f ms\n", name, count_, average(),
+                      count_ > 0 ? min_ : 0.0, max_);
+        std::string text = line;
+        for (int b = 0; b < BUCKETS; ++b) {
+            if (counts_[b] == 0) continue;
+            const int bar = int(40.0 * double(counts_[b]) / double(count_) + 0.5);
+            if (b < BUCKETS - 1) {
+                std::snprintf(line, sizeof(line), "  < %6.1f ms %8zu %s\n", limits()[b], counts_[b], std::string(size_t(bar), '#').c_str());
+            } else {
+                std::snprintf(line, sizeof(line), "  >=%6.1f ms %8zu %s\n", limits()[b - 1], counts_[b], std::string(size_t(bar), '#').c_str());
+            }
+            text += line;
+        }
+        return text;
+    }
+
+private:
+    static const std::array<double, BUCKETS - 1>& limits() {
+        static const std::array<double, BUCKETS - 1> values = {1.0, 2.0, 4.0, 8.0, 16.7, 33.3, 50.0, 100.0};
+        return values;
+    }
+
+    std::array<size_t, BUCKETS> counts_ = {};
+    size_t count_ = 0;
+    double total_ = 0.0, min_ = 0.0, max_ = 0.0;
+};
+
+// Цикл кадров с перерисовкой по изменению: пока сцена не менялась, поток спит в waitEvent;
+// когда кадр нужен, частота ограничивается frameLimit с точной выдержкой (сон, затем досчет).
+//
+//     FrameLoop loop(window);
+//     while (window.isOpen()) {
+//         while (loop.nextEvent(event)) { ...; loop.invalidate(); }
+//         if (!loop.beginFrame()) continue;
+//         ...отрисовка...; window.display();
+//         loop.endFrame();
+//     }
+class FrameLoop {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit FrameLoop(sf::Window& window, unsigned frameLimit = 60) : window_(window) {
+        setFrameLimit(frameLimit);
+        startWall_ = Clock::now();
+        startCpu_ = std::clock();
+        nextFrame_ = startWall_;
+    }
+
+    // 0 — без ограничения частоты
+    void setFrameLimit(unsigned fps) {
+        period_ = fps > 0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps)) : Clock::duration::zero();
+    }
+
+    // Непрерывная перерисовка, как раньше (для сравнения расхода CPU)
+    void setContinuous(bool continuous) { continuous_ = continuous; }
+
+    // Сцена изменилась (ввод, анимация) — нужен новый кадр
+    void invalidate() { dirty_ = true; }
+
+    // Состояние меняется само по себе, без событий окна (удерживаемая клавиша, анимация):
+    // пока флаг стоит, кадры идут с частотой frameLimit, а события читаются без ожидания.
+    // В отличие от invalidate, endFrame флаг не снимает
+    void setAnimating(bool animating) { animating_ = animating; }
+
+    // Следующее событие окна. Если кадр не нужен и событий нет, поток блокируется в waitEvent.
+    // Изменение размера и возврат фокуса сами помечают кадр как устаревший.
+    bool nextEvent(sf::Event& event) {
+        bool received;
+        if (!dirty_ && !continuous_ && !animating_ && !pendingEvent_) {
+            const auto idleStart = Clock::now();
+            received = window_.waitEvent(event);
+            idle_ += Clock::now() - idleStart;
+            idleWaits_++;
+            pendingEvent_ = received;  // После пробуждения дочитываем очередь через pollEvent
+        } else {
+            received = window_.pollEvent(event);
+            if (!received) pendingEvent_ = false;
+        }
+        if (received && (event.type == sf::Event::Resized || event.type == sf::Event::GainedFocus)) dirty_ = true;
+        return received;
+    }
+
+    // true — кадр нужно рисовать; при ограничении частоты здесь выдерживается пауза до его начала
+    bool beginFrame() {
+        if (!dirty_ && !continuous_ && !animating_) return false;
+        pace();
+        const auto now = Clock::now();
+        if (frameStart_ != Clock::time_point()) interval_.add(std::chrono::duration<double, std::milli>(now - frameStart_).count());
+        frameStart_ = now;
+        return true;
+    }
+
+    // Конец кадра: время работы кадра уходит в гистограмму, интервал между началами кадров
+    // считается в beginFrame (в него входит и простой в ожидании событий)
+    void endFrame() {
+        work_.add(std::chrono::duration<double, std::milli>(Clock::now() - frameStart_).count());
+        dirty_ = false;
+    }
+
+    // Итог: кадры, доля времени в ожидании событий и загрузка CPU процессом
+    std::string report() const {
+        const double wallSeconds = std::chrono::duration<double>(Clock::now() - startWall_).count();
+        const double cpuSeconds = double(std::clock() - startCpu_) / CLOCKS_PER_SEC;
+        const double idleSeconds = std::chrono::duration<double>(idle_).count();
+        char line[192];
+        std::snprintf(line, sizeof(line), "Frame loop: %zu frames in %.1f s, idle %.1f%% (%zu waits), CPU %.1f%% of one core\n",
+                      work_.count(), wallSeconds, wallSeconds > 0.0 ? 100.0 * idleSeconds / wallSeconds : 0.0, idleWaits_,
+                      wallSeconds > 0.0 ? 100.0 * cpuSeconds / wallSeconds : 0.0);
+        return line + work_.report("Frame work") + interval_.report("Frame interval");
+    }
+
+private:
+    // Сон почти до срока кадра, последние полторы миллисекунды — активное ожидание: sleep
+    // ошибается на миллисекунды, а досчет в конце держит интервал кадров ровным
+    void pace() {
+        if (period_ == Clock::duration::zero()) return;
+        const auto spinMargin = std::chrono::microseconds(1500);
+        auto now = Clock::now();
+        if (now > nextFrame_) nextFrame_ = now;  // После простоя или долгого кадра — без догоняющей серии
+        if (nextFrame_ > now + spinMargin) std::this_thread::sleep_for(nextFrame_ - now - spinMargin);
+        while (Clock::now() < nextFrame_) std::this_thread::yield();
+        nextFrame_ += period_;
+    }
+
+    sf::Window& window_;
+    Clock::duration period_ = Clock::duration::zero();
+    Clock::time_point nextFrame_, frameStart_, startWall_;
+    Clock::duration idle_ = Clock::duration::zero();
+    std::clock_t startCpu_;
+    size_t idleWaits_ = 0;
+    bool dirty_ = true;  // Первый кадр рисуется всегда
+    bool continuous_ = false;
+    bool animating_ = false;
+    bool pendingEvent_ = false;
+    FrameTimeHistogram work_, interval_;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+// Обход окружности по алгоритму Брезенхэма без зависимости от окна:
+// plot(x, y) вызывается для каждой из восьми симметричных точек очередного шага
+template <typename Plot>
+inline void bresenhamCircle(int centerX, int centerY, int radius, Plot&& plot) {
+    int x = 0;
+    int y = radius;
+    int d = 3 - 2 * radius; // Начальное значение d
+
+    while (x <= y) {
+        // Точки в восьми секторах
+        plot(centerX + x, centerY + y);
+        plot(centerX - x, centerY + y);
+        plot(centerX + x, centerY - y);
+        plot(centerX - x, centerY - y);
+        plot(centerX + y, centerY + x);
+        plot(centerX - y, centerY + x);
+        plot(centerX + y, centerY - x);
+        plot(centerX - y, centerY - x);
+
+        if (d < 0) {
+            d += 4 * x + 6;
+        } else {
+            d += 4 * (x - y) + 10;
+            y--;
+        }
+        x++;
+    }
+}
@@ -1,65 +1,56 @@
 #include <SFML/Graphics.hpp>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
+#include "../common/frame_loop.h"
+#include "bresenham.h"
+
 using namespace sf;
 using namespace std;
 
 // Функция для отрисовки окружности с помощью алгоритма Брезенхэма
 void drawCircle(RenderWindow& window, int centerX, int centerY, int radius) {
-    int x = 0;
-    int y = radius;
-    int d = 3 - 2 * radius; // Начальное значение d
-
-    // Рисуем точки в восьми секторах
-    auto plotPoint = [&](int xOffset, int yOffset) {
-        VertexArray points(PrimitiveType::Points, 8); // Создаем массив из 8 точек
-
-        points[0] = Vertex(Vector2f(centerX + xOffset, centerY + yOffset), Color::Black);
-        points[1] = Vertex(Vector2f(centerX - xOffset, centerY + yOffset), Color::Black);
-        points[2] = Vertex(Vector2f(centerX + xOffset, centerY - yOffset), Color::Black);
-        points[3] = Vertex(Vector2f(centerX - xOffset, centerY - yOffset), Color::Black);
-        points[4] = Vertex(Vector2f(centerX + yOffset, centerY + xOffset), Color::Black);
-        points[5] = Vertex(Vector2f(centerX - yOffset, centerY + xOffset), Color::Black);
-        points[6] = Vertex(Vector2f(centerX + yOffset, centerY - xOffset), Color::Black);
-        points[7] = Vertex(Vector2f(centerX - yOffset, centerY - xOffset), Color::Black);
-
-        window.draw(points); // Рисуем все точки за один вызов
-    };
-
-    // Начинаем рисовать
-    while (x <= y) {
-        plotPoint(x, y);
-        if (d < 0) {
-            d += 4 * x + 6;
-        } else {
-            d += 4 * (x - y) + 10;
-            y--;
-        }
-        x++;
-    }
+    VertexArray points(PrimitiveType::Points);
+    bresenhamCircle(centerX, centerY, radius, [&](int x, int y) {
+        points.append(Vertex(Vector2f(x, y), Color::Black));
+    });
+    window.draw(points); // Рисуем все точки за один вызов
 }
 
-void handleInput(Event event, string& inputString, int& radius) {
+// Возвращает true, если радиус или строка ввода изменились и кадр нужно перерисовать
+bool handleInput(Event event, string& inputString, int& radius) {
     if (event.type == Event::TextEntered) {
         if (event.text.unicode < 128) { // Проверяем на допустимые символы
             if (event.text.unicode == 'b') { // Обработка Backspace
-                if (!inputString.empty())
-                    inputString.pop_back();
+                if (inputString.empty())
+                    return false;
+                inputString.pop_back();
             } else {
                 inputString += static_cast<char>(event.text.unicode); // Добавляем символ в строку
             }
+            return true;
         }
     } else if (event.type == Event::KeyPressed) {
         if (event.key.code == Keyboard::Enter) { // Обработка Enter
             int newRadius = stoi(inputString); // Пробуем преобразовать строку в число
             radius = max(5, newRadius); // Устанавливаем новый радиус
             inputString.clear(); // Очищаем строку после ввода
+            return true;
         }
     }
+    return false;
 }
 
-int main() {
+int main(int argc, char** argv) {
+    unsigned frameLimit = 60; // --fps N: ограничение частоты кадров, 0 — без ограничения
+    bool continuous = false;  // --continuous: перерисовка каждый кадр, как раньше
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) frameLimit = unsigned(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--continuous") == 0) continuous = true;
+    }
+
     RenderWindow window(VideoMode(800, 600), "Circle Drawing with Bresenham's Algorithm");
     
     // Загружаем шрифт
@@ -89,19 +80,30 @@ int main() {
     cout << "Введите координаты центра окружности (x y): ";
     cin >> center.x >> center.y;
 
+    // Кадр рисуется только после ввода, изменения размера или возврата фокуса,
+    // в остальное время поток спит в ожидании событий
+    FrameLoop frameLoop(window, frameLimit);
+    frameLoop.setContinuous(continuous);
+    radiusText.setString("Current Radius: " + to_string(radius));
+    inputText.setString("Enter Radius: " + inputString);
+
     while (window.isOpen()) {    
         Event event;
 
-        while (window.pollEvent(event)) {
+        while (frameLoop.nextEvent(event)) {
             if (event.type == Event::Closed)
                 window.close();
 
-            handleInput(event, inputString, radius); // Обработка ввода
+            if (handleInput(event, inputString, radius)) { // Обработка ввода
+                // Обновляем текст только при изменении радиуса или строки ввода
+                radiusText.setString("Current Radius: " + to_string(radius));
+                inputText.setString("Enter Radius: " + inputString);
+                frameLoop.invalidate();
+            }
         }
 
-        // Обновляем текст с текущим радиусом
-        radiusText.setString("Current Radius: " + to_string(radius));
-        inputText.setString("Enter Radius: " + inputString);
+        if (!window.isOpen() || !frameLoop.beginFrame())
+            continue;
 
         window.clear(Color::White);
         drawCircle(window, center.x, center.y, radius); // Отрисовка окружности
@@ -109,7 +111,9 @@ int main() {
         window.draw(radiusText); // Отображаем текст с радиусом
         window.draw(inputText); // Отображаем текстовое поле для ввода
         window.display();
+        frameLoop.endFrame();
     }
 
+    cout << frameLoop.report();
     return 0;
 }
\ No newline at end of file
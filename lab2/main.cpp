@@ -2,6 +2,12 @@
 
 #include <SFML/Graphics.hpp>
 #include <GLUT/glut.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "../common/cpu_math.h"
+#include "../common/frame_loop.h"
 
 // Определение скоростей перемещения камеры и источников света
 #define CAMERA_SPEED 0.01f
@@ -16,16 +22,19 @@ float light1X = -2.0f, light1Y = 2.0f, light1Z = 0.0f;
 float light2X = 2.0f, light2Y = 2.0f, light2Z = 2.0f;
 float light3X = 0.0f, light3Y = -2.0f, light3Z = -2.0f;
 
-// Обработчик ввода для камерыю
-void handleInput() {
+// Обработчик ввода для камерыю. Возвращает true, если камера сдвинулась
+bool handleInput() {
+    const float oldX = cameraX, oldZ = cameraZ;
     if (sf::Keyboard::isKeyPressed(sf::Keyboard::W)) cameraZ -= CAMERA_SPEED; // Вперед
     if (sf::Keyboard::isKeyPressed(sf::Keyboard::S)) cameraZ += CAMERA_SPEED; // Назад
     if (sf::Keyboard::isKeyPressed(sf::Keyboard::A)) cameraX -= CAMERA_SPEED; // Влево
     if (sf::Keyboard::isKeyPressed(sf::Keyboard::D)) cameraX += CAMERA_SPEED; // Вправо
+    return cameraX != oldX || cameraZ != oldZ;
 }
 
-// Обработчик ввода для источников света
-void handleLightMovement() {
+// Обработчик ввода для источников света. Возвращает true, если хотя бы один источник сдвинулся
+bool handleLightMovement() {
+    const float old[6] = {light1X, light1Y, light2X, light2Y, light3X, light3Y};
     if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left)) light1X -= LIGHT_SPEED;
     if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right)) light1X += LIGHT_SPEED;
     if (sf::Keyboard::isKeyPressed(sf::Keyboard::Up)) light1Y += LIGHT_SPEED;
@@ -40,24 +49,35 @@ void handleLightMovement() {
     if (sf::Keyboard::isKeyPressed(sf::Keyboard::C)) light3X += LIGHT_SPEED;
     if (sf::Keyboard::isKeyPressed(sf::Keyboard::X)) light3Y += LIGHT_SPEED;
     if (sf::Keyboard::isKeyPressed(sf::Keyboard::V)) light3Y -= LIGHT_SPEED;
+    return old[0] != light1X || old[1] != light1Y || old[2] != light2X || old[3] != light2Y || old[4] != light3X ||
+           old[5] != light3Y;
+}
+
+// Стек видовых матриц на CPU вместо glPushMatrix / glPopMatrix
+MatrixStack modelView;
+
+// Загрузка вершины стека в OpenGL перед отрисовкой объекта
+void applyModelView() {
+    glLoadMatrixf(modelView.top().m);
 }
 
 void setCamera() {
     glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    gluLookAt(cameraX, cameraY, cameraZ, 0, 0, 0, 0, 1, 0); // Позиционируем камеру
+    modelView.loadIdentity();
+    modelView.lookAt(cameraX, cameraY, cameraZ, 0, 0, 0, 0, 1, 0); // Позиционируем камеру
+    applyModelView();
 }
 
 void setPerspective() {
     glMatrixMode(GL_PROJECTION); // Переключаемся на матрицу проекции
-    glLoadIdentity(); // Сбрасываем матрицу
-    gluPerspective(fieldOfView, 1500.0f / 1200.0f, 0.1f, 100.0f);  // Устанавливаем перспективу
+    glLoadMatrixf(mat4Perspective(fieldOfView, 1500.0f / 1200.0f, 0.1f, 100.0f).m);  // Устанавливаем перспективу
 }
 
 // Отрисовка куба с нормалями
 void drawCube() {
-    glPushMatrix();
-    glTranslatef(-2.0f, 0.0f, 0.0f);
+    modelView.push();
+    modelView.translate(-2.0f, 0.0f, 0.0f);
+    applyModelView();
     glBegin(GL_QUADS);
 
     // Передняя грань
@@ -109,14 +129,16 @@ void drawCube() {
     glVertex3f(-1.0f, -1.0f, -1.0f);
 
     glEnd();
-    glPopMatrix();
+    modelView.pop();
+    applyModelView();
 }
 
 
 // Отрисовка пирамиды
 void drawPyramid() {
-    glPushMatrix();
-    glTranslatef(2.0f, 0.0f, 0.0f);
+    modelView.push();
+    modelView.translate(2.0f, 0.0f, 0.0f);
+    applyModelView();
     glBegin(GL_TRIANGLES);
     glColor3f(1.0f, 0.0f, 0.0f); // Передняя грань
     glVertex3f(0.0f, 1.0f, 0.0f);
@@ -135,7 +157,8 @@ void drawPyramid() {
     glVertex3f(-1.0f, -1.0f, -1.0f);
     glVertex3f(-1.0f, -1.0f, 1.0f);
     glEnd();
-    glPopMatrix();
+    modelView.pop();
+    applyModelView();
 }
 
 // Отрисовка цилиндра с крышкой и низом
@@ -144,8 +167,9 @@ void drawCylinder() {
     float height = 1.0f; // Высота цилиндра
     int slices = 30; // Количество сегментов для окружностей (основание и крышка)
 
-    glPushMatrix();
-    glTranslatef(0.0f, 2.0f, 0.0f);
+    modelView.push();
+    modelView.translate(0.0f, 2.0f, 0.0f);
+    applyModelView();
     
     GLUquadric* quadric = gluNewQuadric();
     gluCylinder(quadric, radius, radius, height, slices, 1); // Тело цилиндра
@@ -171,35 +195,49 @@ void drawCylinder() {
     }
     glEnd();
 
-    glPopMatrix();
+    modelView.pop();
+    applyModelView();
 }
 
 // Отрисовка источников света
 void drawLightSources() {
-    glPushMatrix();
-    glTranslatef(light1X, light1Y, light1Z);
+    modelView.push();
+    modelView.translate(light1X, light1Y, light1Z);
+    applyModelView();
     glColor3f(1.0f, 1.0f, 0.0f); // Желтые источники света
     glutSolidSphere(0.1, 10, 10); // Сфера для первого источника
-    glPopMatrix();
+    modelView.pop();
+    applyModelView();
 
-    glPushMatrix();
-    glTranslatef(light2X, light2Y, light2Z);
+    modelView.push();
+    modelView.translate(light2X, light2Y, light2Z);
+    applyModelView();
     glColor3f(0.0f, 1.0f, 0.0f); // Зеленые источники света
     glutSolidSphere(0.1, 10, 10); // Сфера для второго источника
-    glPopMatrix();
+    modelView.pop();
+    applyModelView();
 
-    glPushMatrix();
-    glTranslatef(light3X, light3Y, light3Z);
+    modelView.push();
+    modelView.translate(light3X, light3Y, light3Z);
+    applyModelView();
     glColor3f(0.0f, 0.0f, 1.0f); // Синие источники света
     glutSolidSphere(0.1, 10, 10); // Сфера для третьего источника
-    glPopMatrix();
+    modelView.pop();
+    applyModelView();
 }
 
-int main() {
+int main(int argc, char** argv) {
+    unsigned frameLimit = 60; // --fps N: ограничение частоты кадров, 0 — без ограничения
+    bool continuous = false;  // --continuous: перерисовка каждый кадр, как раньше
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) frameLimit = unsigned(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--continuous") == 0) continuous = true;
+    }
+
     sf::ContextSettings settings;
     settings.depthBits = 24;
     sf::RenderWindow window(sf::VideoMode(1500, 1200), "3D View", sf::Style::Default, settings);
-    window.setVerticalSyncEnabled(false);
+    window.setVerticalSyncEnabled(false); // Частоту держит FrameLoop, а не синхронизация драйвера
 
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f); // Установка цвета фона (черный)
     glClearDepth(1.0f); // Установка глубины для буфера глубины
@@ -209,16 +247,30 @@ int main() {
     glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST); // Установка высокого качества перспективы
 
 
+    // Пока клавиши движения удерживаются, кадры идут с частотой frameLimit;
+    // когда сцена неподвижна, поток спит в ожидании событий окна
+    FrameLoop frameLoop(window, frameLimit);
+    frameLoop.setContinuous(continuous);
+
     while (window.isOpen()) {
         sf::Event event;
-        while (window.pollEvent(event)) {
+        while (frameLoop.nextEvent(event)) {
             if (event.type == sf::Event::Closed) {
                 window.close();
             }
         }
+        if (!window.isOpen()) {
+            break;
+        }
 
-        handleInput();         // Обработка ввода для камеры
-        handleLightMovement(); // Обработка ввода для источников света
+        // Клавиши опрашиваются через isKeyPressed, а не события: пока хоть что-то движется,
+        // цикл не засыпает в ожидании событий и рисует кадры с частотой frameLimit
+        const bool cameraMoved = handleInput();        // Обработка ввода для камеры
+        const bool lightsMoved = handleLightMovement(); // Обработка ввода для источников света
+        frameLoop.setAnimating(cameraMoved || lightsMoved);
+        if (!frameLoop.beginFrame()) {
+            continue;
+        }
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Очищаем экран и буфер глубины
 
@@ -232,8 +284,10 @@ int main() {
         drawLightSources();
 
         window.display(); // Отображаем обновленное окно
+        frameLoop.endFrame();
     }
 
+    std::cout << frameLoop.report();
     return 0;
 }
 
@@ -2,66 +2,232 @@
 
 #include <SFML/Graphics.hpp>
 #include <GLUT/glut.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
+#include <string>
 #include <vector>
 
+#include "sphere_mesh.h"
+#include "transform.h"
+
 #define TRANSFORM_SPEED 0.1f
 #define ROTATION_SPEED 2.0f
 
-float scale = 1.0f;
-float rotationX = 0.0f, rotationY = 0.0f, rotationZ = 0.0f;
-float translateX = 0.0f, translateY = 0.0f, translateZ = -5.0f;
-
-std::vector<std::string> transformationOrder = {"scale", "rotate", "translate"};
+// Конвейер преобразований: итоговая матрица пересобирается только при изменении параметров
+TransformPipeline pipeline(ORDER_SCALE_ROTATE_TRANSLATE);
 
 void handleInput() {
-    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Up)) translateY += TRANSFORM_SPEED;
-    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Down)) translateY -= TRANSFORM_SPEED;
-    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left)) translateX -= TRANSFORM_SPEED;
-    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right)) translateX += TRANSFORM_SPEED;
-    if (sf::Keyboard::isKeyPressed(sf::Keyboard::K)) translateZ += TRANSFORM_SPEED;
-    if (sf::Keyboard::isKeyPressed(sf::Keyboard::L)) translateZ -= TRANSFORM_SPEED;
-
-    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Q)) rotationX += ROTATION_SPEED;
-    if (sf::Keyboard::isKeyPressed(sf::Keyboard::A)) rotationX -= ROTATION_SPEED;
-    if (sf::Keyboard::isKeyPressed(sf::Keyboard::W)) rotationY += ROTATION_SPEED;
-    if (sf::Keyboard::isKeyPressed(sf::Keyboard::S)) rotationY -= ROTATION_SPEED;
-    if (sf::Keyboard::isKeyPressed(sf::Keyboard::E)) rotationZ += ROTATION_SPEED;
-    if (sf::Keyboard::isKeyPressed(sf::Keyboard::D)) rotationZ -= ROTATION_SPEED;
-
-    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Z) && scale < 10.0f) scale += 0.01f; // Ограничение масштаба
-    if (sf::Keyboard::isKeyPressed(sf::Keyboard::X) && scale > 0.01f) scale -= 0.01f; // Ограничение масштаба
-
-    if (sf::Keyboard::isKeyPressed(sf::Keyboard::R)) {
-        transformationOrder = {"scale", "rotate", "translate"};
-    }
-    if (sf::Keyboard::isKeyPressed(sf::Keyboard::T)) {
-        transformationOrder = {"translate", "rotate", "scale"};
-    }
+    TransformParams p = pipeline.params();
+
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Up)) p.translateY += TRANSFORM_SPEED;
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Down)) p.translateY -= TRANSFORM_SPEED;
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left)) p.translateX -= TRANSFORM_SPEED;
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right)) p.translateX += TRANSFORM_SPEED;
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::K)) p.translateZ += TRANSFORM_SPEED;
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::L)) p.translateZ -= TRANSFORM_SPEED;
+
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Q)) p.rotationX += ROTATION_SPEED;
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::A)) p.rotationX -= ROTATION_SPEED;
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::W)) p.rotationY += ROTATION_SPEED;
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::S)) p.rotationY -= ROTATION_SPEED;
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::E)) p.rotationZ += ROTATION_SPEED;
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::D)) p.rotationZ -= ROTATION_SPEED;
+
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Z) && p.scale < 10.0f) p.scale += 0.01f; // Ограничение масштаба
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::X) && p.scale > 0.01f) p.scale -= 0.01f; // Ограничение масштаба
+
+    pipeline.setParams(p);
+
+    // Смена порядка не выделяет память: выбирается заранее собранная функция композиции
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::R)) pipeline.setOrder(ORDER_SCALE_ROTATE_TRANSLATE);
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::T)) pipeline.setOrder(ORDER_TRANSLATE_ROTATE_SCALE);
 }
 
+// Стек видовых матриц на CPU вместо glPushMatrix / glPopMatrix
+MatrixStack modelView;
+
 void applyTransformations() {
-    for (const auto& transformation : transformationOrder) {
+    modelView.multiply(pipeline.matrix()); // Одна готовая матрица вместо пяти вызовов glScalef/glRotatef/glTranslatef
+}
+
+#define SPHERE_SEGMENTS 30
+
+// Буферы сферы: сетка строится один раз при запуске, а не тесселируется каждый кадр
+GLuint sphereVBO = 0, sphereIBO = 0;
+GLsizei sphereIndexCount = 0;
+
+void createSphere() {
+    IndexedMesh mesh = buildOptimizedSphereMesh(1.0f, SPHERE_SEGMENTS, SPHERE_SEGMENTS);
+    sphereIndexCount = GLsizei(mesh.indices.size());
+
+    glGenBuffers(1, &sphereVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(MeshVertex), mesh.vertices.data(), GL_STATIC_DRAW);
+
+    glGenBuffers(1, &sphereIBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereIBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(uint32_t), mesh.indices.data(), GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void drawSphere() {
+    glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereIBO);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY); // Нормали для освещения
+    glVertexPointer(3, GL_FLOAT, sizeof(MeshVertex), (const GLvoid*)offsetof(MeshVertex, position));
+    glNormalPointer(GL_FLOAT, sizeof(MeshVertex), (const GLvoid*)offsetof(MeshVertex, normal));
+
+    glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0);
+
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+// Старый способ: разбор порядка по строкам и пять отдельных умножений на каждый кадр
+Mat4 composeByNames(const std::vector<std::string>& order, const TransformParams& p) {
+    Mat4 m = mat4Identity();
+    for (const auto& transformation : order) {
         if (transformation == "scale") {
-            glScalef(scale, scale, scale);
+            m = mat4Multiply(m, opMatrix<TransformOp::Scale>(p));
         } else if (transformation == "rotate") {
-            glRotatef(rotationX, 1.0f, 0.0f, 0.0f);
-            glRotatef(rotationY, 0.0f, 1.0f, 0.0f);
-            glRotatef(rotationZ, 0.0f, 0.0f, 1.0f);
+            TransformParams rx, ry, rz;
+            rx.rotationX = p.rotationX;
+            ry.rotationY = p.rotationY;
+            rz.rotationZ = p.rotationZ;
+            m = mat4Multiply(m, rotationMatrix(rx));
+            m = mat4Multiply(m, rotationMatrix(ry));
+            m = mat4Multiply(m, rotationMatrix(rz));
         } else if (transformation == "translate") {
-            glTranslatef(translateX, translateY, translateZ);
+            m = mat4Multiply(m, opMatrix<TransformOp::Translate>(p));
         }
     }
+    return m;
 }
 
-void drawSphere() {
-    GLUquadric* quadric = gluNewQuadric();
-    gluQuadricNormals(quadric, GLU_SMOOTH); // Добавление нормалей для освещения
-    gluSphere(quadric, 1.0f, 30, 30); // Можно увеличить количество сегментов
-    gluDeleteQuadric(quadric);
+float maxDifference(const Mat4& a, const Mat4& b) {
+    float diff = 0.0f;
+    for (int i = 0; i < 16; ++i) diff = std::max(diff, std::fabs(a.m[i] - b.m[i]));
+    return diff;
+}
+
+template <typename F>
+double measureMs(F&& body) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
-int main() {
+// Замеры без окна: ./app --bench
+int runBenchmark() {
+    const int frames = 1000000;
+    const size_t objects = 100000;
+    const size_t points = 1000000;
+    float checksum = 0.0f;
+
+    TransformParams p;
+    p.scale = 1.5f;
+    p.rotationX = 30.0f; p.rotationY = 45.0f; p.rotationZ = 60.0f;
+    p.translateX = 1.0f; p.translateY = -2.0f; p.translateZ = -5.0f;
+
+    // Проверка: свернутые специализации совпадают со старым построчным вариантом
+    std::vector<std::string> srt = {"scale", "rotate", "translate"};
+    std::vector<std::string> trs = {"translate", "rotate", "scale"};
+    float errSrt = maxDifference(composeByNames(srt, p), compileTransformOrder(ORDER_SCALE_ROTATE_TRANSLATE)(p));
+    float errTrs = maxDifference(composeByNames(trs, p), compileTransformOrder(ORDER_TRANSLATE_ROTATE_SCALE)(p));
+    std::cout << "max |string - compiled| SRT: " << errSrt << ", TRS: " << errTrs << std::endl;
+
+    double legacyMs = measureMs([&] {
+        for (int i = 0; i < frames; ++i) {
+            p.rotationY = float(i % 360);
+            checksum += composeByNames(srt, p).m[12];
+        }
+    });
+
+    TransformPipeline bench(ORDER_SCALE_ROTATE_TRANSLATE);
+    double rebuildMs = measureMs([&] {
+        for (int i = 0; i < frames; ++i) {
+            p.rotationY = float(i % 360);
+            bench.setParams(p);
+            checksum += bench.matrix().m[12];
+        }
+    });
+
+    double cachedMs = measureMs([&] {
+        for (int i = 0; i < frames; ++i) {
+            bench.setParams(p);
+            checksum += bench.matrix().m[12];
+        }
+    });
+
+    std::cout << "string dispatch:   " << legacyMs << " ms / " << frames << " frames" << std::endl;
+    std::cout << "compiled rebuild:  " << rebuildMs << " ms / " << frames << " frames" << std::endl;
+    std::cout << "compiled cached:   " << cachedMs << " ms / " << frames << " frames" << std::endl;
+
+    // Пакетные операции для множества объектов
+    std::vector<TransformParams> params(objects);
+    for (size_t i = 0; i < objects; ++i) {
+        params[i] = p;
+        params[i].rotationZ = float(i % 360);
+        params[i].translateX = float(i % 100) * 0.1f;
+    }
+    std::vector<Mat4> models(objects), world(objects);
+    Mat4 view = mat4Identity();
+    view.m[14] = -10.0f;
+
+    double composeMs = measureMs([&] {
+        composeTransforms(ORDER_SCALE_ROTATE_TRANSLATE, params.data(), models.data(), objects);
+        mat4MultiplyBatch(view, models.data(), world.data(), objects);
+    });
+    checksum += world[objects - 1].m[12];
+
+    std::vector<Vec4> in(points), out(points);
+    for (size_t i = 0; i < points; ++i) {
+        in[i] = {float(i % 97) * 0.01f, float(i % 89) * 0.01f, float(i % 83) * 0.01f, 1.0f};
+    }
+    const Mat4& m = bench.matrix();
+    double pointsMs = measureMs([&] { mat4TransformBatch(m, in.data(), out.data(), points); });
+    checksum += out[points - 1].x;
+
+    std::cout << "batch compose:     " << composeMs << " ms / " << objects << " objects" << std::endl;
+    std::cout << "batch points:      " << pointsMs << " ms / " << points << " points" << std::endl;
+    std::cout << "checksum: " << checksum << std::endl;
+
+    // Сетка сферы: ACMR до и после оптимизации на симуляторе FIFO-кэша вершин
+    IndexedMesh sphere = buildSphereMesh(1.0f, SPHERE_SEGMENTS, SPHERE_SEGMENTS);
+    IndexedMesh optimized;
+    double optimizeMs = measureMs([&] { optimized = buildOptimizedSphereMesh(1.0f, SPHERE_SEGMENTS, SPHERE_SEGMENTS); });
+    std::cout << "sphere: " << sphere.vertices.size() << " shared vertices, " << sphere.indices.size() / 3
+              << " triangles (non-indexed ACMR 3.0), optimized in " << optimizeMs << " ms" << std::endl;
+
+    bool cacheImproved = true;
+    for (size_t cacheSize : {16, 32}) {
+        float before = simulateVertexCacheACMR(sphere.indices, cacheSize);
+        float after = simulateVertexCacheACMR(optimized.indices, cacheSize);
+        std::cout << "ACMR FIFO " << cacheSize << ": " << before << " -> " << after << std::endl;
+        cacheImproved = cacheImproved && after < before;
+    }
+
+    return (errSrt < 1e-4f && errTrs < 1e-4f && cacheImproved) ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--bench") == 0) {
+        return runBenchmark();
+    }
+
+    TransformParams initial;
+    initial.translateZ = -5.0f;
+    pipeline.setParams(initial);
+
     sf::ContextSettings settings;
     settings.depthBits = 24;
     sf::RenderWindow window(sf::VideoMode(800, 600), "3D Transformations", sf::Style::Default, settings);
@@ -76,10 +242,11 @@ int main() {
     GLfloat lightPos[] = {1.0f, 1.0f, 1.0f, 0.0f};
     glLightfv(GL_LIGHT0, GL_POSITION, lightPos);
 
+    createSphere();
+
     // Установка матрицы проекции
     glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(45.0f, 800 / 600.f, 0.1f, 100.0f);
+    glLoadMatrixf(mat4Perspective(45.0f, 800 / 600.f, 0.1f, 100.0f).m);
     
     glMatrixMode(GL_MODELVIEW); // Вернуться к модели/виду
 
@@ -95,17 +262,18 @@ int main() {
         handleInput();
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glLoadIdentity();
-        
+        modelView.loadIdentity();
+
         // Установка камеры
-        gluLookAt(0.0f, 0.0f, 10.0f,
-                  0.0f, 0.0f, 0.0f,
-                  0.0f, 1.0f, 0.0f);
+        modelView.lookAt(0.0f, 0.0f, 10.0f,
+                         0.0f, 0.0f, 0.0f,
+                         0.0f, 1.0f, 0.0f);
 
-        glPushMatrix();
+        modelView.push();
         applyTransformations();
+        glLoadMatrixf(modelView.top().m);
         drawSphere();
-        glPopMatrix();
+        modelView.pop();
 
         window.display();
     }
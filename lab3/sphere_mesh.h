@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Вершина сферы: позиция и нормаль (формат для glVertexPointer / glNormalPointer)
+struct MeshVertex {
+    float position[3];
+    float normal[3];
+};
+
+struct IndexedMesh {
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;  // Тройки индексов треугольников
+};
+
+// Сфера с общими вершинами, разбиение как у gluSphere: slices вокруг оси Z, stacks от +Z к -Z.
+// Полюса хранятся одной вершиной, шов по долготе не дублируется (текстурных координат нет).
+inline IndexedMesh buildSphereMesh(float radius, int slices, int stacks) {
+    const float pi = 3.14159265358979f;
+    IndexedMesh mesh;
+
+    auto addVertex = [&](float nx, float ny, float nz) {
+        mesh.vertices.push_back({{nx * radius, ny * radius, nz * radius}, {nx, ny, nz}});
+    };
+
+    addVertex(0.0f, 0.0f, 1.0f);  // Северный полюс
+    for (int i = 1; i < stacks; ++i) {
+        float phi = pi * float(i) / float(stacks);
+        for (int j = 0; j < slices; ++j) {
+            float theta = 2.0f * pi * float(j) / float(slices);
+            addVertex(std::sin(phi) * std::cos(theta), std::sin(phi) * std::sin(theta), std::cos(phi));
+        }
+    }
+    addVertex(0.0f, 0.0f, -1.0f);  // Южный полюс
+
+    const uint32_t north = 0;
+    const uint32_t south = uint32_t(mesh.vertices.size() - 1);
+    auto ring = [&](int i, int j) { return uint32_t(1 + (i - 1) * slices + (j % slices)); };
+
+    // Треугольники идут полосами по широте, обход против часовой стрелки снаружи
+    for (int j = 0; j < slices; ++j) {
+        mesh.indices.insert(mesh.indices.end(), {north, ring(1, j), ring(1, j + 1)});
+    }
+    for (int i = 1; i < stacks - 1; ++i) {
+        for (int j = 0; j < slices; ++j) {
+            uint32_t a = ring(i, j), b = ring(i + 1, j), c = ring(i + 1, j + 1), d = ring(i, j + 1);
+            mesh.indices.insert(mesh.indices.end(), {a, b, c, a, c, d});
+        }
+    }
+    for (int j = 0; j < slices; ++j) {
+        mesh.indices.insert(mesh.indices.end(), {ring(stacks - 1, j), south, ring(stacks - 1, j + 1)});
+    }
+    return mesh;
+}
+
+// Симулятор пост-трансформного кэша вершин (FIFO, как у большинства GPU).
+// Возвращает ACMR: среднее число промахов кэша на треугольник (идеал ~0.5, худший случай 3.0).
+inline float simulateVertexCacheACMR(const std::vector<uint32_t>& indices, size_t cacheSize) {
+    if (indices.empty()) return 0.0f;
+    std::deque<uint32_t> fifo;
+    size_t misses = 0;
+    for (uint32_t index : indices) {
+        bool hit = false;
+        for (uint32_t cached : fifo) {
+            if (cached == index) { hit = true; break; }
+        }
+        if (hit) continue;
+        ++misses;
+        fifo.push_back(index);
+        if (fifo.size() > cacheSize) fifo.pop_front();
+    }
+    return float(misses) / float(indices.size() / 3);
+}
+
+// Переупорядочивание треугольников по алгоритму Форсайта (Linear-Speed Vertex Cache Optimisation).
+// Моделируется LRU-кэш размера cacheSize, на каждом шаге выбирается треугольник с наибольшей оценкой.
+inline std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = 32) {
+    const size_t triangleCount = indices.size() / 3;
+    const float cacheDecayPower = 1.5f;
+    const float lastTriangleScore = 0.75f;
+    const float valenceBoostScale = 2.0f;
+    const float valenceBoostPower = 0.5f;
+
+    // Смежность вершина -> треугольники в виде сжатых списков
+    std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+    for (uint32_t index : indices) adjacencyOffset[index + 1]++;
+    for (size_t v = 0; v < vertexCount; ++v) adjacencyOffset[v + 1] += adjacencyOffset[v];
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        for (int k = 0; k < 3; ++k) adjacency[fill[indices[t * 3 + k]]++] = uint32_t(t);
+    }
+
+    std::vector<uint32_t> remaining(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) remaining[v] = adjacencyOffset[v + 1] - adjacencyOffset[v];
+    std::vector<int> cachePosition(vertexCount, -1);
+
+    auto vertexScore = [&](uint32_t v) {
+        if (remaining[v] == 0) return -1.0f;
+        float score = 0.0f;
+        int position = cachePosition[v];
+        if (position >= 0) {
+            if (position < 3) {
+                score = lastTriangleScore;
+            } else {
+                float scaler = 1.0f / float(cacheSize - 3);
+                score = std::pow(1.0f - float(position - 3) * scaler, cacheDecayPower);
+            }
+        }
+        score += valenceBoostScale * std::pow(float(remaining[v]), -valenceBoostPower);
+        return score;
+    };
+
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) vertexScores[v] = vertexScore(uint32_t(v));
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+    }
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    std::vector<uint32_t> cache;
+    cache.reserve(cacheSize + 3);
+    size_t scanPosition = 0;  // Для поиска следующего треугольника, когда в кэше кандидатов нет
+
+    int64_t bestTriangle = -1;
+    for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+        if (bestTriangle < 0) {
+            float bestScore = -1.0f;
+            for (; scanPosition < triangleCount && emitted[scanPosition]; ++scanPosition) {}
+            for (size_t t = scanPosition; t < triangleCount; ++t) {
+                if (!emitted[t] && triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    bestTriangle = int64_t(t);
+                }
+            }
+        }
+
+        const uint32_t* tri = &indices[size_t(bestTriangle) * 3];
+        result.insert(result.end(), tri, tri + 3);
+        emitted[size_t(bestTriangle)] = true;
+
+        // Вершины треугольника переходят в начало LRU-кэша
+        std::vector<uint32_t> newCache(tri, tri + 3);
+        for (uint32_t v : cache) {
+            if (v != tri[0] && v != tri[1] && v != tri[2]) newCache.push_back(v);
+        }
+        for (int k = 0; k < 3; ++k) {
+            uint32_t v = tri[k];
+            // Удаляем треугольник из списка смежности вершины
+            uint32_t begin = adjacencyOffset[v];
+            uint32_t end = begin + remaining[v];
+            for (uint32_t a = begin; a < end; ++a) {
+                if (adjacency[a] == uint32_t(bestTriangle)) {
+                    adjacency[a] = adjacency[end - 1];
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+
+        for (size_t position = 0; position < newCache.size(); ++position) {
+            uint32_t v = newCache[position];
+            cachePosition[v] = position < size_t(cacheSize) ? int(position) : -1;
+        }
+        // Пересчет оценок (включая только что вытесненные вершины) и выбор лучшего треугольника
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for (uint32_t v : newCache) vertexScores[v] = vertexScore(v);
+        for (uint32_t v : newCache) {
+            uint32_t begin = adjacencyOffset[v];
+            for (uint32_t a = begin; a < begin + remaining[v]; ++a) {
+                uint32_t t = adjacency[a];
+                float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+                triangleScores[t] = score;
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestTriangle = int64_t(t);
+                }
+            }
+        }
+
+        if (newCache.size() > size_t(cacheSize)) newCache.resize(cacheSize);
+        cache.swap(newCache);
+    }
+    return result;
+}
+
+// Переупорядочивание вершин в порядке первого использования, чтобы выборка шла последовательно по памяти
+inline void optimizeVertexFetch(IndexedMesh& mesh) {
+    const uint32_t unused = 0xFFFFFFFFu;
+    std::vector<uint32_t> remap(mesh.vertices.size(), unused);
+    std::vector<MeshVertex> reordered;
+    reordered.reserve(mesh.vertices.size());
+    for (uint32_t& index : mesh.indices) {
+        if (remap[index] == unused) {
+            remap[index] = uint32_t(reordered.size());
+            reordered.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+    mesh.vertices.swap(reordered);
+}
+
+// Полная подготовка сферы: общие вершины, порядок треугольников под кэш, порядок вершин под выборку
+inline IndexedMesh buildOptimizedSphereMesh(float radius, int slices, int stacks) {
+    IndexedMesh mesh = buildSphereMesh(radius, slices, stacks);
+    mesh.indices = optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    optimizeVertexFetch(mesh);
+    return mesh;
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "../common/cpu_math.h"
+
+// Операции преобразования, из которых складывается порядок применения
+enum class TransformOp : uint8_t { Scale, Rotate, Translate };
+
+using TransformOrder = std::array<TransformOp, 3>;
+
+constexpr TransformOrder ORDER_SCALE_ROTATE_TRANSLATE = {TransformOp::Scale, TransformOp::Rotate, TransformOp::Translate};
+constexpr TransformOrder ORDER_TRANSLATE_ROTATE_SCALE = {TransformOp::Translate, TransformOp::Rotate, TransformOp::Scale};
+
+// Параметры преобразования объекта (углы в градусах, как у glRotatef)
+struct TransformParams {
+    float scale = 1.0f;
+    float rotationX = 0.0f, rotationY = 0.0f, rotationZ = 0.0f;
+    float translateX = 0.0f, translateY = 0.0f, translateZ = 0.0f;
+
+    bool operator==(const TransformParams& o) const {
+        return scale == o.scale &&
+               rotationX == o.rotationX && rotationY == o.rotationY && rotationZ == o.rotationZ &&
+               translateX == o.translateX && translateY == o.translateY && translateZ == o.translateZ;
+    }
+    bool operator!=(const TransformParams& o) const { return !(*this == o); }
+};
+
+// Матрица поворота Rx * Ry * Rz (эквивалент трех вызовов glRotatef подряд)
+inline Mat4 rotationMatrix(const TransformParams& p) {
+    const float toRad = 3.14159265358979f / 180.0f;
+    float cx = std::cos(p.rotationX * toRad), sx = std::sin(p.rotationX * toRad);
+    float cy = std::cos(p.rotationY * toRad), sy = std::sin(p.rotationY * toRad);
+    float cz = std::cos(p.rotationZ * toRad), sz = std::sin(p.rotationZ * toRad);
+
+    Mat4 r = mat4Identity();
+    // Столбец 0
+    r.m[0] = cy * cz;
+    r.m[1] = sx * sy * cz + cx * sz;
+    r.m[2] = -cx * sy * cz + sx * sz;
+    // Столбец 1
+    r.m[4] = -cy * sz;
+    r.m[5] = -sx * sy * sz + cx * cz;
+    r.m[6] = cx * sy * sz + sx * cz;
+    // Столбец 2
+    r.m[8] = sy;
+    r.m[9] = -sx * cy;
+    r.m[10] = cx * cy;
+    return r;
+}
+
+template <TransformOp Op>
+Mat4 opMatrix(const TransformParams& p);
+
+template <>
+inline Mat4 opMatrix<TransformOp::Scale>(const TransformParams& p) {
+    Mat4 r = mat4Identity();
+    r.m[0] = r.m[5] = r.m[10] = p.scale;
+    return r;
+}
+
+template <>
+inline Mat4 opMatrix<TransformOp::Rotate>(const TransformParams& p) {
+    return rotationMatrix(p);
+}
+
+template <>
+inline Mat4 opMatrix<TransformOp::Translate>(const TransformParams& p) {
+    Mat4 r = mat4Identity();
+    r.m[12] = p.translateX;
+    r.m[13] = p.translateY;
+    r.m[14] = p.translateZ;
+    return r;
+}
+
+// Общий случай: порядок известен на этапе компиляции, произведение разворачивается без ветвлений
+template <TransformOp A, TransformOp B, TransformOp C>
+inline Mat4 composeTransform(const TransformParams& p) {
+    return mat4Multiply(mat4Multiply(opMatrix<A>(p), opMatrix<B>(p)), opMatrix<C>(p));
+}
+
+// S * R * T: масштаб умножает поворот, перенос проходит через S * R
+template <>
+inline Mat4 composeTransform<TransformOp::Scale, TransformOp::Rotate, TransformOp::Translate>(const TransformParams& p) {
+    Mat4 r = rotationMatrix(p);
+    for (int i = 0; i < 12; ++i) r.m[i] *= p.scale;
+    r.m[12] = r.m[0] * p.translateX + r.m[4] * p.translateY + r.m[8] * p.translateZ;
+    r.m[13] = r.m[1] * p.translateX + r.m[5] * p.translateY + r.m[9] * p.translateZ;
+    r.m[14] = r.m[2] * p.translateX + r.m[6] * p.translateY + r.m[10] * p.translateZ;
+    return r;
+}
+
+// T * R * S: перенос остается в последнем столбце без изменений
+template <>
+inline Mat4 composeTransform<TransformOp::Translate, TransformOp::Rotate, TransformOp::Scale>(const TransformParams& p) {
+    Mat4 r = rotationMatrix(p);
+    for (int i = 0; i < 12; ++i) r.m[i] *= p.scale;
+    r.m[12] = p.translateX;
+    r.m[13] = p.translateY;
+    r.m[14] = p.translateZ;
+    return r;
+}
+
+using ComposeFn = Mat4 (*)(const TransformParams&);
+
+// "Компиляция" порядка: выбор заранее инстанцированной функции для одной из 6 перестановок
+inline ComposeFn compileTransformOrder(const TransformOrder& order) {
+    using Op = TransformOp;
+    int key = int(order[0]) * 9 + int(order[1]) * 3 + int(order[2]);
+    switch (key) {
+        case 0 * 9 + 1 * 3 + 2: return &composeTransform<Op::Scale, Op::Rotate, Op::Translate>;
+        case 0 * 9 + 2 * 3 + 1: return &composeTransform<Op::Scale, Op::Translate, Op::Rotate>;
+        case 1 * 9 + 0 * 3 + 2: return &composeTransform<Op::Rotate, Op::Scale, Op::Translate>;
+        case 1 * 9 + 2 * 3 + 0: return &composeTransform<Op::Rotate, Op::Translate, Op::Scale>;
+        case 2 * 9 + 0 * 3 + 1: return &composeTransform<Op::Translate, Op::Scale, Op::Rotate>;
+        case 2 * 9 + 1 * 3 + 0: return &composeTransform<Op::Translate, Op::Rotate, Op::Scale>;
+        default: return nullptr;  // Порядок с повторяющимися операциями не поддерживается
+    }
+}
+
+// Конвейер преобразований: итоговая матрица пересчитывается только при изменении параметров или порядка
+class TransformPipeline {
+public:
+    explicit TransformPipeline(const TransformOrder& order = ORDER_SCALE_ROTATE_TRANSLATE) {
+        setOrder(order);
+    }
+
+    void setOrder(const TransformOrder& order) {
+        if (compose_ != nullptr && order == order_) return;
+        ComposeFn fn = compileTransformOrder(order);
+        if (fn == nullptr) return;
+        order_ = order;
+        compose_ = fn;
+        dirty_ = true;
+    }
+
+    void setParams(const TransformParams& params) {
+        if (params == params_) return;
+        params_ = params;
+        dirty_ = true;
+    }
+
+    const TransformParams& params() const { return params_; }
+    const TransformOrder& order() const { return order_; }
+    ComposeFn composeFn() const { return compose_; }
+
+    const Mat4& matrix() {
+        if (dirty_) {
+            matrix_ = compose_(params_);
+            dirty_ = false;
+        }
+        return matrix_;
+    }
+
+private:
+    TransformOrder order_ = ORDER_SCALE_ROTATE_TRANSLATE;
+    TransformParams params_;
+    ComposeFn compose_ = nullptr;
+    Mat4 matrix_ = mat4Identity();
+    bool dirty_ = true;
+};
+
+// Пакетное построение матриц для множества объектов с общим порядком преобразований
+inline void composeTransforms(const TransformOrder& order, const TransformParams* params, Mat4* out, size_t count) {
+    ComposeFn fn = compileTransformOrder(order);
+    if (fn == nullptr) return;
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = fn(params[i]);
+    }
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "../common/cpu_math.h"
+
+// Точечный источник света в мировых координатах. Раскладка совпадает с двумя
+// текселями RGBA32F буфера источников: (позиция, радиус), (цвет, интенсивность).
+struct PointLight {
+    float position[3];
+    float radius;
+    float color[3];
+    float intensity;
+};
+
+// Кластерное разбиение пирамиды видимости: tilesX x tilesY плиток на экране и
+// slices срезов по глубине с экспоненциальным шагом (ближние срезы тоньше).
+// Для каждого кластера строится компактный список источников, задевающих его объем.
+class ClusteredLightGrid {
+public:
+    void configure(int tilesX, int tilesY, int slices, float fovyDegrees, float aspect, float zNear, float zFar) {
+        tilesX_ = tilesX;
+        tilesY_ = tilesY;
+        slices_ = slices;
+        zNear_ = zNear;
+        zFar_ = zFar;
+        tanHalfY_ = std::tan(fovyDegrees * 3.14159265358979f / 360.0f);
+        tanHalfX_ = tanHalfY_ * aspect;
+
+        float logRatio = std::log(zFar / zNear);
+        depthScale_ = float(slices) / logRatio;
+        depthBias_ = -float(slices) * std::log(zNear) / logRatio;
+
+        // Границы кластеров в видовом пространстве (x, y, глубина = -z) считаются один раз
+        bounds_.resize(clusterCount());
+        for (int k = 0; k < slices; ++k) {
+            float d0 = sliceDepth(k), d1 = sliceDepth(k + 1);
+            for (int j = 0; j < tilesY; ++j) {
+                float y0 = (-1.0f + 2.0f * float(j) / float(tilesY)) * tanHalfY_;
+                float y1 = (-1.0f + 2.0f * float(j + 1) / float(tilesY)) * tanHalfY_;
+                for (int i = 0; i < tilesX; ++i) {
+                    float x0 = (-1.0f + 2.0f * float(i) / float(tilesX)) * tanHalfX_;
+                    float x1 = (-1.0f + 2.0f * float(i + 1) / float(tilesX)) * tanHalfX_;
+                    Aabb& box = bounds_[clusterIndex(i, j, k)];
+                    box.min[0] = std::min(x0 * d0, x0 * d1);
+                    box.max[0] = std::max(x1 * d0, x1 * d1);
+                    box.min[1] = std::min(y0 * d0, y0 * d1);
+                    box.max[1] = std::max(y1 * d0, y1 * d1);
+                    box.min[2] = d0;
+                    box.max[2] = d1;
+                }
+            }
+        }
+    }
+
+    // Распределение источников по кластерам: для каждого источника перебираются только
+    // кластеры, чьи границы пересекают ограничивающий бокс сферы, затем точная проверка сфера-AABB.
+    void assign(const std::vector<PointLight>& lights, const Mat4& view) {
+        pairCluster_.clear();
+        pairLight_.clear();
+
+        for (uint32_t l = 0; l < uint32_t(lights.size()); ++l) {
+            const PointLight& light = lights[l];
+            Vec4 p = mat4Transform(view, {light.position[0], light.position[1], light.position[2], 1.0f});
+            float center[3] = {p.x, p.y, -p.z};
+            float r = light.radius;
+
+            if (center[2] + r < sliceDepth(0) || center[2] - r > sliceDepth(slices_)) continue;  // Вне диапазона глубин
+
+            // Соседние срезы и плитки добавляются с запасом: точную отсечку делает проверка сфера-AABB
+            int k0 = std::max(sliceOf(std::max(center[2] - r, zNear_)) - 1, 0);
+            int k1 = std::min(sliceOf(std::min(center[2] + r, zFar_)) + 1, slices_ - 1);
+            for (int k = k0; k <= k1; ++k) {
+                int i0 = 0, i1 = tilesX_ - 1, j0 = 0, j1 = tilesY_ - 1;
+                while (i0 < i1 && bounds_[clusterIndex(i0 + 1, 0, k)].max[0] < center[0] - r) ++i0;
+                while (i1 > i0 && bounds_[clusterIndex(i1 - 1, 0, k)].min[0] > center[0] + r) --i1;
+                while (j0 < j1 && bounds_[clusterIndex(0, j0 + 1, k)].max[1] < center[1] - r) ++j0;
+                while (j1 > j0 && bounds_[clusterIndex(0, j1 - 1, k)].min[1] > center[1] + r) --j1;
+
+                for (int j = j0; j <= j1; ++j) {
+                    for (int i = i0; i <= i1; ++i) {
+                        uint32_t cluster = uint32_t(clusterIndex(i, j, k));
+                        if (sphereIntersects(bounds_[cluster], center, r)) {
+                            pairCluster_.push_back(cluster);
+                            pairLight_.push_back(l);
+                        }
+                    }
+                }
+            }
+        }
+
+        // Сортировка подсчетом: пары (кластер, источник) -> смещение и число в общем списке
+        ranges_.assign(size_t(clusterCount()) * 2, 0);
+        for (uint32_t cluster : pairCluster_) ranges_[cluster * 2 + 1]++;
+        uint32_t offset = 0;
+        for (int c = 0; c < clusterCount(); ++c) {
+            ranges_[c * 2] = offset;
+            offset += ranges_[c * 2 + 1];
+        }
+        lightIndices_.resize(pairLight_.size());
+        std::vector<uint32_t> fill(static_cast<size_t>(clusterCount()), 0);
+        for (size_t n = 0; n < pairCluster_.size(); ++n) {
+            uint32_t cluster = pairCluster_[n];
+            lightIndices_[ranges_[cluster * 2] + fill[cluster]++] = pairLight_[n];
+        }
+    }
+
+    // Эталон для проверки: каждый источник против каждого кластера
+    void assignBruteForce(const std::vector<PointLight>& lights, const Mat4& view) {
+        ranges_.assign(size_t(clusterCount()) * 2, 0);
+        lightIndices_.clear();
+        std::vector<float> centers(lights.size() * 3);
+        for (size_t l = 0; l < lights.size(); ++l) {
+            Vec4 p = mat4Transform(view, {lights[l].position[0], lights[l].position[1], lights[l].position[2], 1.0f});
+            centers[l * 3] = p.x;
+            centers[l * 3 + 1] = p.y;
+            centers[l * 3 + 2] = -p.z;
+        }
+        for (int c = 0; c < clusterCount(); ++c) {
+            ranges_[c * 2] = uint32_t(lightIndices_.size());
+            for (size_t l = 0; l < lights.size(); ++l) {
+                if (sphereIntersects(bounds_[c], &centers[l * 3], lights[l].radius)) lightIndices_.push_back(uint32_t(l));
+            }
+            ranges_[c * 2 + 1] = uint32_t(lightIndices_.size()) - ranges_[c * 2];
+        }
+    }
+
+    int clusterCount() const { return tilesX_ * tilesY_ * slices_; }
+    int tilesX() const { return tilesX_; }
+    int tilesY() const { return tilesY_; }
+    int slices() const { return slices_; }
+
+    // Срез по глубине во фрагментном шейдере: floor(log(depth) * depthScale + depthBias)
+    float depthScale() const { return depthScale_; }
+    float depthBias() const { return depthBias_; }
+
+    // Пары (смещение, количество) для каждого кластера и общий список индексов источников
+    const std::vector<uint32_t>& clusterRanges() const { return ranges_; }
+    const std::vector<uint32_t>& lightIndices() const { return lightIndices_; }
+
+private:
+    struct Aabb {
+        float min[3];
+        float max[3];
+    };
+
+    int clusterIndex(int i, int j, int k) const { return i + tilesX_ * (j + tilesY_ * k); }
+
+    float sliceDepth(int k) const { return zNear_ * std::pow(zFar_ / zNear_, float(k) / float(slices_)); }
+
+    int sliceOf(float depth) const {
+        int k = int(std::floor(std::log(depth) * depthScale_ + depthBias_));
+        return std::clamp(k, 0, slices_ - 1);
+    }
+
+    static bool sphereIntersects(const Aabb& box, const float* center, float radius) {
+        float distance = 0.0f;
+        for (int a = 0; a < 3; ++a) {
+            float v = std::clamp(center[a], box.min[a], box.max[a]) - center[a];
+            distance += v * v;
+        }
+        return distance <= radius * radius;
+    }
+
+    int tilesX_ = 0, tilesY_ = 0, slices_ = 0;
+    float zNear_ = 0.1f, zFar_ = 100.0f;
+    float tanHalfX_ = 1.0f, tanHalfY_ = 1.0f;
+    float depthScale_ = 1.0f, depthBias_ = 0.0f;
+
+    std::vector<Aabb> bounds_;
+    std::vector<uint32_t> ranges_;
+    std::vector<uint32_t> lightIndices_;
+    std::vector<uint32_t> pairCluster_, pairLight_;
+};
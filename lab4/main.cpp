@@ -3,7 +3,25 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../common/cpu_math.h"
+#include "clustered_lighting.h"
+#include "mesh_pipeline.h"
+#include "program_cache.h"
+#include "render_queue.h"
+#include "shader_program.h"
+#include "soft_rasterizer.h"
 
 // Вершинный шейдер (Vertex Shader) для преобразования вершин
 const char* vertexShaderSource = R"(
@@ -13,15 +31,26 @@ layout(location = 1) in vec3 aColor; // Цвет вершины
 layout(location = 2) in vec3 aNormal; // Нормаль вершины
 out vec3 ourColor;  // Цвет фрагмента
 out vec3 FragPos;  // Позиция фрагмента
+out float ViewDepth; // Глубина фрагмента в видовом пространстве (для выбора кластера)
 out vec3 Normal;   // Нормаль фрагмента
-uniform mat4 model;    // Модельная матрица
-uniform mat4 view;     // Видовая матрица
-uniform mat4 projection; // Проекционная матрица
+layout(location = 3) in mat4 instanceModel;  // Модельная матрица объекта (из буфера экземпляров)
+layout(location = 7) in mat3 instanceNormal; // Матрица нормалей объекта, посчитанная на CPU
+uniform vec3 meshScale;  // Масштаб деквантования позиций сетки
+uniform vec3 meshOffset; // Смещение деквантования позиций сетки
+layout(std140) uniform FrameData { // Общие для всех программ данные кадра
+    mat4 view;         // Видовая матрица
+    mat4 projection;   // Проекционная матрица
+    vec3 viewPos;      // Позиция камеры
+    vec3 lightPos;     // Позиция источника света
+};
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0f));  // Преобразование позиции вершины с учетом модели
-    Normal = mat3(transpose(inverse(model))) * aNormal; // Преобразование нормали
-    gl_Position = projection * view * vec4(FragPos, 1.0f); // Преобразование позиции с учетом проекции и вида
+    vec3 position = aPos * meshScale + meshOffset;  // Позиция хранится как нормализованное 16-битное целое
+    FragPos = vec3(instanceModel * vec4(position, 1.0f));  // Преобразование позиции вершины с учетом модели
+    Normal = instanceNormal * aNormal; // Преобразование нормали
+    vec4 viewSpace = view * vec4(FragPos, 1.0f);
+    ViewDepth = -viewSpace.z;
+    gl_Position = projection * viewSpace; // Преобразование позиции с учетом проекции и вида
     ourColor = aColor;  // Передача цвета в фрагментный шейдер
 })";
 
@@ -30,12 +59,22 @@ const char* fragmentShaderSource = R"(
 #version 330 core
 in vec3 ourColor;   // Цвет фрагмента
 in vec3 FragPos;    // Позиция фрагмента
+in float ViewDepth; // Глубина фрагмента в видовом пространстве
 in vec3 Normal;     // Нормаль фрагмента
 out vec4 FragColor; // Итоговый цвет фрагмента
-uniform vec3 lightPos; // Позиция источника света
-uniform vec3 viewPos;  // Позиция камеры
+layout(std140) uniform FrameData { // Общие для всех программ данные кадра
+    mat4 view;         // Видовая матрица
+    mat4 projection;   // Проекционная матрица
+    vec3 viewPos;      // Позиция камеры
+    vec3 lightPos;     // Позиция источника света
+};
 uniform float specularPower;  // Степень спекулярного освещения
 uniform float specularIntensity; // Интенсивность спекулярного освещения
+uniform samplerBuffer pointLights;          // Точечные источники: (позиция, радиус), (цвет, интенсивность)
+uniform usamplerBuffer clusterRanges;       // Для каждого кластера: смещение и число источников
+uniform usamplerBuffer clusterLightIndices; // Общий список индексов источников по кластерам
+uniform vec4 clusterGrid;   // Число плиток по X и Y, число срезов по глубине
+uniform vec4 clusterParams; // Размер кадра в пикселях, масштаб и сдвиг логарифма глубины
 void main()
 {
     // Амбиентное освещение: постоянный общий свет
@@ -55,6 +94,28 @@ void main()
 
     // Итоговый цвет: сумма всех компонентов освещения
     vec3 result = ambient + diffuse + specular;
+
+    // Точечные источники: перебираются только те, что попали в кластер фрагмента
+    ivec3 grid = ivec3(clusterGrid.xyz);
+    ivec2 tile = clamp(ivec2(gl_FragCoord.xy / clusterParams.xy * vec2(grid.xy)), ivec2(0), grid.xy - 1);
+    int slice = clamp(int(floor(log(ViewDepth) * clusterParams.z + clusterParams.w)), 0, grid.z - 1);
+    uvec2 range = texelFetch(clusterRanges, tile.x + grid.x * (tile.y + grid.y * slice)).xy;
+    for (uint i = 0u; i < range.y; ++i) {
+        int light = int(texelFetch(clusterLightIndices, int(range.x + i)).x);
+        vec4 positionRadius = texelFetch(pointLights, light * 2);
+        vec4 colorIntensity = texelFetch(pointLights, light * 2 + 1);
+
+        vec3 toLight = positionRadius.xyz - FragPos;
+        float dist = length(toLight);
+        float attenuation = clamp(1.0f - dist / positionRadius.w, 0.0f, 1.0f);
+        attenuation *= attenuation;  // Плавное затухание до нуля на радиусе источника
+        vec3 pointDir = toLight / max(dist, 1e-4f);
+
+        float pointDiff = max(dot(norm, pointDir), 0.0f);
+        float pointSpec = pow(max(dot(viewDir, reflect(-pointDir, norm)), 0.0f), specularPower) * specularIntensity;
+        result += (pointDiff * ourColor + pointSpec) * colorIntensity.rgb * colorIntensity.w * attenuation;
+    }
+
     FragColor = vec4(result, 1.0f);  // Запись итогового цвета
 })";
 
@@ -83,7 +144,17 @@ GLuint indices[] = {
     0, 1, 2,  3, 4, 5,  6, 7, 8,  9, 10, 11
 };
 
+const size_t rawVertexCount = sizeof(vertices) / (9 * sizeof(GLfloat));
+
+// Подготовленная сетка сцены (пирамида и куб в общих буферах): после первого запуска
+// читается из файла без повторной обработки, пока не изменились исходные данные
+#define MESH_FILE "scene.cgmesh"
+#define MESH_PYRAMID 0
+#define MESH_CUBE 1
+PackedMesh mesh;
+
 GLuint VAO, VBO, EBO;  // Объект вершинного массива, буфер вершин и индексный буфер
+GLuint instanceVBO, indirectBuffer;  // Потоковые буферы данных экземпляров и косвенных команд
 GLuint vertexShader, fragmentShader, shaderProgram; // Шейдеры и программа
 
 // Параметры для управления вращением куба и освещением
@@ -94,6 +165,101 @@ glm::vec3 viewPos(0.0f, 0.0f, 3.0f);  // Позиция камеры
 float specularPower = 32.0f; // Степень спекулярного освещения
 float specularIntensity = 1.0f; // Интенсивность спекулярного освещения
 
+// Точка привязки uniform-буфера с данными кадра, общая для всех программ
+#define FRAME_DATA_BINDING 0
+
+// Данные кадра в раскладке std140: vec3 выравнивается до 16 байт
+struct FrameData {
+    float view[16];
+    float projection[16];
+    float viewPos[4];
+    float lightPos[4];
+};
+
+ShaderProgram program;       // Программа с кэшем uniform-переменных
+UniformBuffer frameBuffer;   // Uniform-буфер данных кадра
+
+// Материал — параметры блика; материал 0 у пирамиды lab4
+struct Material {
+    float specularPower;
+    float specularIntensity;
+};
+
+// Объект сцены для --objects N: крутится вокруг своей оси Y
+struct SceneObject {
+    float position[3];
+    float scale;
+    float phase;
+    uint32_t material;
+    uint32_t mesh;
+};
+
+// Команда glMultiDrawElementsIndirect (раскладка фиксирована спецификацией)
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLuint baseVertex;
+    GLuint baseInstance;
+};
+
+#define INSTANCE_ATTRIBUTE 3  // Первый атрибут данных экземпляра (mat4 модели, затем mat3 нормалей)
+
+std::vector<Material> materials;
+std::vector<SceneObject> sceneObjects;
+RenderQueue renderQueue;
+std::vector<DrawElementsIndirectCommand> indirectCommands;
+
+// Параметры кластерного освещения: 16x9 плиток и 24 среза глубины в пределах проекции
+#define CLUSTER_TILES_X 16
+#define CLUSTER_TILES_Y 9
+#define CLUSTER_SLICES 24
+#define POINT_LIGHTS_UNIT 1
+#define CLUSTER_RANGES_UNIT 2
+#define CLUSTER_INDICES_UNIT 3
+
+std::vector<PointLight> pointLights; // Дополнительные точечные источники (--lights N)
+ClusteredLightGrid lightGrid;        // Распределение источников по кластерам на CPU
+
+// Буфер, доступный шейдеру как samplerBuffer / usamplerBuffer
+struct TextureBuffer {
+    GLuint buffer = 0;
+    GLuint texture = 0;
+
+    void create(GLenum format, GLuint unit) {
+        glGenBuffers(1, &buffer);
+        glGenTextures(1, &texture);
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        upload(nullptr, 0);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // Пустой буфер не допускается, поэтому выделяется минимум 16 байт
+    void upload(const void* data, size_t bytes) {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, GLsizeiptr(bytes > 0 ? bytes : 16), bytes > 0 ? data : nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        glStats.bufferUploads++;
+    }
+};
+
+TextureBuffer pointLightBuffer, clusterRangeBuffer, clusterIndexBuffer;
+
+// Случайные точечные источники вокруг пирамиды (фиксированное зерно для воспроизводимости)
+std::vector<PointLight> generatePointLights(size_t count, float extent, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> position(-extent, extent);
+    std::uniform_real_distribution<float> radius(0.5f, 2.0f);
+    std::uniform_real_distribution<float> color(0.2f, 1.0f);
+    std::vector<PointLight> lights(count);
+    for (PointLight& light : lights) {
+        light = {{position(rng), position(rng), position(rng)}, radius(rng), {color(rng), color(rng), color(rng)}, 1.0f};
+    }
+    return lights;
+}
+
 // Компиляция шейдера
 void compileShader(GLuint shader, const char* source) {
     glShaderSource(shader, 1, &source, NULL);  // Привязка исходного кода шейдера
@@ -107,8 +273,12 @@ void compileShader(GLuint shader, const char* source) {
     }
 }
 
-// Создание и компиляция шейдерной программы
-void createShaderProgram() {
+// Кэш бинарников программ: при повторном запуске компиляция и линковка пропускаются
+ProgramCache programCache("shader_cache");
+const std::string shaderDefines = "";  // Define-ы варианта программы, входят в ключ кэша
+
+// Компиляция и линковка программы из исходников
+void buildShaderProgram(bool retrievable) {
     // Создание шейдеров
     vertexShader = glCreateShader(GL_VERTEX_SHADER);
     fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
@@ -117,6 +287,7 @@ void createShaderProgram() {
 
     // Создание и линковка программы
     shaderProgram = glCreateProgram();
+    if (retrievable) glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glAttachShader(shaderProgram, vertexShader);
     glAttachShader(shaderProgram, fragmentShader);
     glLinkProgram(shaderProgram);
@@ -128,8 +299,208 @@ void createShaderProgram() {
         glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);  // Получение информации об ошибке
         std::cout << "Program Linking Failed\n" << infoLog << std::endl;
     }
+}
+
+// Создание шейдерной программы: из кэша, а при промахе или несовпадении формата — из исходников
+void createShaderProgram() {
+    auto start = std::chrono::steady_clock::now();
+    bool cacheSupported = programCache.supported();
+    bool fromCache = false;
+
+    uint64_t key = 0;
+    if (cacheSupported) {
+        key = programCache.makeKey(vertexShaderSource, fragmentShaderSource, shaderDefines);
+        shaderProgram = programCache.load(key);
+        fromCache = shaderProgram != 0;
+    }
+    if (!fromCache) {
+        buildShaderProgram(cacheSupported);
+        if (cacheSupported) programCache.store(key, shaderProgram);
+    }
 
     glUseProgram(shaderProgram);  // Использование программы шейдеров
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Shader program ready in " << ms << " ms ("
+              << (!cacheSupported ? "binary cache unsupported" : fromCache ? "warm cache" : "cold cache") << ")" << std::endl;
+}
+
+// Импорт пирамиды из исходного массива: слияние вершин, проверка индексов и упаковка
+PackedMesh buildPyramidMesh() {
+    const RawVertex* raw = reinterpret_cast<const RawVertex*>(vertices);
+    Mesh imported = deduplicateVertices(raw, indices, sizeof(indices) / sizeof(indices[0]));
+    return packMesh(imported);
+}
+
+// Куб с ребром 1: по 4 вершины на грань, у каждой грани свой цвет
+Mesh buildCubeMesh() {
+    const float faces[6][3][3] = {
+        // Нормаль, две оси грани
+        {{1, 0, 0}, {0, 0, -1}, {0, 1, 0}}, {{-1, 0, 0}, {0, 0, 1}, {0, 1, 0}},
+        {{0, 1, 0}, {1, 0, 0}, {0, 0, -1}}, {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}},
+        {{0, 0, 1}, {1, 0, 0}, {0, 1, 0}}, {{0, 0, -1}, {-1, 0, 0}, {0, 1, 0}},
+    };
+    const float colors[6][3] = {{1.0f, 0.5f, 0.0f}, {0.0f, 0.6f, 1.0f}, {1.0f, 1.0f, 0.2f},
+                                {0.6f, 0.2f, 1.0f}, {0.2f, 1.0f, 0.5f}, {1.0f, 0.3f, 0.5f}};
+    const float corners[4][2] = {{-0.5f, -0.5f}, {0.5f, -0.5f}, {0.5f, 0.5f}, {-0.5f, 0.5f}};
+
+    Mesh cube;
+    for (int f = 0; f < 6; ++f) {
+        const uint32_t base = uint32_t(cube.vertices.size());
+        for (const float* corner : corners) {
+            RawVertex v;
+            for (int k = 0; k < 3; ++k) {
+                v.position[k] = 0.5f * faces[f][0][k] + corner[0] * faces[f][1][k] + corner[1] * faces[f][2][k];
+                v.color[k] = colors[f][k];
+                v.normal[k] = faces[f][0][k];
+            }
+            cube.vertices.push_back(v);
+        }
+        cube.indices.insert(cube.indices.end(), {base, base + 1, base + 2, base, base + 2, base + 3});
+    }
+    return cube;
+}
+
+// Ключ исходных данных сцены: массивы пирамиды и сгенерированный куб (дешевле, чем полная сборка)
+uint64_t sceneMeshSourceHash() {
+    uint64_t hash = hashMeshSource(vertices, sizeof(vertices));
+    hash = hashMeshSource(indices, sizeof(indices), hash);
+    return hashMeshSource(buildCubeMesh(), hash);
+}
+
+// Сетка сцены: все сетки в общих буферах вершин и индексов, каждая — отдельная часть
+PackedMesh buildSceneMesh() {
+    const RawVertex* raw = reinterpret_cast<const RawVertex*>(vertices);
+    Mesh scene;
+    appendSubMesh(scene, deduplicateVertices(raw, indices, sizeof(indices) / sizeof(indices[0])));  // MESH_PYRAMID
+    appendSubMesh(scene, buildCubeMesh());                                                           // MESH_CUBE
+    return packMesh(scene);
+}
+
+// Объекты сцены на сетке перед камерой, сетка и материал выбираются случайно (фиксированное зерно)
+std::vector<SceneObject> generateSceneObjects(size_t count, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<SceneObject> objects(count);
+    const int side = std::max(1, int(std::ceil(std::sqrt(float(count)))));
+    for (size_t i = 0; i < count; ++i) {
+        SceneObject& object = objects[i];
+        const float column = float(int(i) % side) / float(side) - 0.5f;
+        const float row = float(int(i) / side) / float(side) - 0.5f;
+        const float depth = 4.0f + 30.0f * unit(rng);
+        object.position[0] = column * depth * 1.6f;
+        object.position[1] = row * depth * 1.2f;
+        object.position[2] = -depth;
+        object.scale = 0.3f + 0.4f * unit(rng);
+        object.phase = 360.0f * unit(rng);
+        object.material = uint32_t(rng() % materials.size());
+        object.mesh = uint32_t(rng() % mesh.subMeshes.size());
+    }
+    return objects;
+}
+
+// Глубина центра объекта в видовом пространстве — младшие биты ключа сортировки
+float viewDepth(const Mat4& view, const Mat4& model) {
+    Vec4 center = mat4Transform(view, {model.m[12], model.m[13], model.m[14], 1.0f});
+    return -center.z;
+}
+
+// Указатели атрибутов экземпляра, начиная с экземпляра firstInstance (делитель 1 — по значению на экземпляр)
+void bindInstanceAttributes(uint32_t firstInstance) {
+    const GLsizei stride = GLsizei(RenderQueue::INSTANCE_FLOATS * sizeof(float));
+    const size_t base = size_t(firstInstance) * size_t(stride);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    for (int column = 0; column < 4; ++column) {
+        glVertexAttribPointer(INSTANCE_ATTRIBUTE + column, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(base + column * 4 * sizeof(float)));
+    }
+    for (int column = 0; column < 3; ++column) {
+        glVertexAttribPointer(INSTANCE_ATTRIBUTE + 4 + column, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(base + (16 + column * 4) * sizeof(float)));
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glStats.attributeBinds++;
+}
+
+void setupInstanceAttributes() {
+    glGenBuffers(1, &instanceVBO);
+    for (int i = 0; i < 7; ++i) {
+        glEnableVertexAttribArray(INSTANCE_ATTRIBUTE + i);
+        glVertexAttribDivisor(INSTANCE_ATTRIBUTE + i, 1);
+    }
+    bindInstanceAttributes(0);
+}
+
+// Отрисовка отсортированной очереди: данные экземпляров — одной загрузкой в потоковый буфер,
+// затем один вызов на партию (инстансинг) или на серию партий с одинаковым материалом (multi-draw-indirect)
+void submitRenderQueue(bool indirect, ShaderProgram::Handle specularPowerUniform, ShaderProgram::Handle specularIntensityUniform) {
+    const std::vector<float>& instances = renderQueue.instanceData();
+    const GLsizeiptr instanceBytes = GLsizeiptr(instances.size() * sizeof(float));
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, instanceBytes, nullptr, GL_STREAM_DRAW);  // Новое хранилище: без ожидания прошлого кадра
+    glBufferSubData(GL_ARRAY_BUFFER, 0, instanceBytes, instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glStats.bufferUploads++;
+
+    const std::vector<DrawBatch>& batches = renderQueue.batches();
+    if (indirect) {
+        indirectCommands.clear();
+        for (const DrawBatch& batch : batches) {
+            const SubMesh& part = mesh.subMeshes[batch.mesh];
+            indirectCommands.push_back({part.indexCount, batch.instanceCount, part.firstIndex, 0, batch.firstInstance});
+        }
+        const GLsizeiptr commandBytes = GLsizeiptr(indirectCommands.size() * sizeof(DrawElementsIndirectCommand));
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commandBytes, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commandBytes, indirectCommands.data());
+        glStats.bufferUploads++;
+    }
+
+    glBindVertexArray(VAO);
+    glStats.vertexArrayBinds++;
+    for (size_t first = 0; first < batches.size();) {
+        const DrawBatch& batch = batches[first];
+        program.use();  // Ключ содержит программу; пока она одна, переключений нет
+        program.setFloat(specularPowerUniform, materials[batch.material].specularPower);
+        program.setFloat(specularIntensityUniform, materials[batch.material].specularIntensity);
+
+        if (indirect) {
+            size_t last = first + 1;
+            while (last < batches.size() && batches[last].program == batch.program && batches[last].material == batch.material) ++last;
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const GLvoid*)(first * sizeof(DrawElementsIndirectCommand)),
+                                        GLsizei(last - first), 0);
+            glStats.drawCalls++;
+            for (; first < last; ++first) glStats.instancesDrawn += batches[first].instanceCount;
+        } else {
+            // Без базового экземпляра в GL 3.3 указатели атрибутов сдвигаются на начало партии
+            const SubMesh& part = mesh.subMeshes[batch.mesh];
+            bindInstanceAttributes(batch.firstInstance);
+            glDrawElementsInstanced(GL_TRIANGLES, GLsizei(part.indexCount), GL_UNSIGNED_INT,
+                                    (const GLvoid*)(size_t(part.firstIndex) * sizeof(uint32_t)), GLsizei(batch.instanceCount));
+            glStats.drawCalls++;
+            glStats.instancesDrawn += batch.instanceCount;
+            ++first;
+        }
+    }
+    glBindVertexArray(0);
+    if (indirect) glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+// Замер загрузки исходного формата (36 байт на вершину, без индексации) для сравнения
+void measureRawUpload() {
+    GLuint buffers[2];
+    glGenBuffers(2, buffers);
+    glFinish();
+    auto start = std::chrono::steady_clock::now();
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glFinish();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Raw mesh: " << rawVertexCount << " vertices x " << sizeof(RawVertex) << " bytes, "
+              << sizeof(vertices) + sizeof(indices) << " bytes total, upload " << ms << " ms" << std::endl;
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glDeleteBuffers(2, buffers);
 }
 
 // Обработка пользовательского ввода
@@ -164,7 +535,335 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);  // Устанавливаем новый размер окна
 }
 
-int main() {
+float maxDifference(const Mat4& a, const glm::mat4& b) {
+    const float* bp = glm::value_ptr(b);
+    float diff = 0.0f;
+    for (int i = 0; i < 16; ++i) diff = std::max(diff, std::fabs(a.m[i] - bp[i]));
+    return diff;
+}
+
+// Сверка cpu_math с glm и замер пакетного преобразования вершин без окна: ./app --bench
+int runBenchmark() {
+    const size_t vertexCount = 4000000;
+    const float tolerance = 1e-4f;
+    bool ok = true;
+
+    auto check = [&](const char* name, float diff) {
+        std::cout << name << ": max |cpu_math - glm| = " << diff << std::endl;
+        ok = ok && diff < tolerance;
+    };
+
+    Mat4 model = mat4Multiply(mat4Rotate(30.0f, 1.0f, 0.0f, 0.0f), mat4Rotate(-50.0f, 0.0f, 1.0f, 0.0f));
+    model = mat4Multiply(model, mat4Translate(0.5f, -1.0f, 2.0f));
+    model = mat4Multiply(model, mat4Scale(2.0f, 2.0f, 2.0f));
+    glm::mat4 glmModel = glm::rotate(glm::mat4(1.0f), glm::radians(30.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    glmModel = glm::rotate(glmModel, glm::radians(-50.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glmModel = glm::translate(glmModel, glm::vec3(0.5f, -1.0f, 2.0f));
+    glmModel = glm::scale(glmModel, glm::vec3(2.0f, 2.0f, 2.0f));
+    check("model", maxDifference(model, glmModel));
+
+    Mat4 view = mat4LookAt(viewPos.x, viewPos.y, viewPos.z, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+    glm::mat4 glmView = glm::lookAt(viewPos, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    check("view", maxDifference(view, glmView));
+
+    Mat4 projection = mat4Perspective(45.0f, 800.0f / 600.0f, 0.1f, 100.0f);
+    glm::mat4 glmProjection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+    check("projection", maxDifference(projection, glmProjection));
+
+    Mat4 mvp = mat4Multiply(mat4Multiply(projection, view), model);
+    glm::mat4 glmMvp = glmProjection * glmView * glmModel;
+    check("mvp", maxDifference(mvp, glmMvp));
+
+    check("affine inverse", maxDifference(mat4AffineInverse(model), glm::inverse(glmModel)));
+
+    Mat3 normalMatrix = mat4NormalMatrix(model);
+    glm::mat3 glmNormal = glm::transpose(glm::inverse(glm::mat3(glmModel)));
+    float normalDiff = 0.0f;
+    for (int i = 0; i < 9; ++i) normalDiff = std::max(normalDiff, std::fabs(normalMatrix.m[i] - glm::value_ptr(glmNormal)[i]));
+    check("normal matrix", normalDiff);
+
+    // Пакетное преобразование вершин: glm по одной вершине против SIMD-ядра
+    std::vector<Vec4> in(vertexCount), out(vertexCount);
+    std::vector<glm::vec4> glmIn(vertexCount), glmOut(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        float x = float(i % 1013) * 0.001f - 0.5f;
+        float y = float(i % 1019) * 0.001f - 0.5f;
+        float z = float(i % 1021) * 0.001f - 0.5f;
+        in[i] = {x, y, z, 1.0f};
+        glmIn[i] = glm::vec4(x, y, z, 1.0f);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < vertexCount; ++i) glmOut[i] = glmMvp * glmIn[i];
+    double glmMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    mat4TransformBatch(mvp, in.data(), out.data(), vertexCount);
+    double simdMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    float batchDiff = 0.0f;
+    for (size_t i = 0; i < vertexCount; i += 997) {
+        batchDiff = std::max(batchDiff, std::fabs(out[i].x - glmOut[i].x));
+        batchDiff = std::max(batchDiff, std::fabs(out[i].w - glmOut[i].w));
+    }
+    check("batch transform", batchDiff);
+
+    std::cout << "glm per-vertex: " << glmMs << " ms / " << vertexCount << " vertices" << std::endl;
+    std::cout << "SIMD batch:     " << simdMs << " ms / " << vertexCount << " vertices ("
+              << vertexCount / simdMs / 1000.0 << " M vertices/s)" << std::endl;
+
+    // Конвейер сетки: слияние вершин, упаковка и круговая запись в файл
+    auto meshStart = std::chrono::steady_clock::now();
+    PackedMesh packed = buildPyramidMesh();
+    double packMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - meshStart).count();
+
+    float dequantError = 0.0f;
+    const RawVertex* raw = reinterpret_cast<const RawVertex*>(vertices);
+    for (size_t i = 0; i < packed.indices.size(); ++i) {
+        const PackedVertex& p = packed.vertices[packed.indices[i]];
+        for (int k = 0; k < 3; ++k) {
+            float restored = p.position[k] / 32767.0f * packed.positionScale[k] + packed.positionOffset[k];
+            dequantError = std::max(dequantError, std::fabs(restored - raw[indices[i]].position[k]));
+        }
+    }
+    std::cout << "mesh: max position dequantization error = " << dequantError << std::endl;
+    ok = ok && dequantError < 1e-4f;
+
+    PackedMesh loaded;
+    const uint64_t sourceHash = sceneMeshSourceHash();
+    bool roundTrip = saveMesh("bench.cgmesh", packed, sourceHash) && loadMesh("bench.cgmesh", loaded, sourceHash) &&
+                     loaded.vertices.size() == packed.vertices.size() && loaded.indices == packed.indices &&
+                     loaded.subMeshes == packed.subMeshes;
+    // Файл, собранный из других исходных данных, должен отвергаться
+    bool staleRejected = !loadMesh("bench.cgmesh", loaded, sourceHash ^ 1);
+    std::remove("bench.cgmesh");
+    ok = ok && roundTrip && staleRejected;
+
+    size_t rawBytes = sizeof(vertices) + sizeof(indices);
+    size_t packedBytes = packed.vertices.size() * sizeof(PackedVertex) + packed.indices.size() * sizeof(uint32_t);
+    std::cout << "mesh: " << rawVertexCount << " -> " << packed.vertices.size() << " vertices, "
+              << sizeof(RawVertex) << " -> " << sizeof(PackedVertex) << " bytes/vertex, "
+              << rawBytes << " -> " << packedBytes << " bytes, packed in " << packMs << " ms, file round trip "
+              << (roundTrip ? "ok" : "FAILED") << ", stale file " << (staleRejected ? "rejected" : "ACCEPTED") << std::endl;
+
+    // Кластерное освещение: время распределения источников и сверка с полным перебором
+    ClusteredLightGrid grid, reference;
+    grid.configure(CLUSTER_TILES_X, CLUSTER_TILES_Y, CLUSTER_SLICES, 45.0f, 800.0f / 600.0f, 0.1f, 100.0f);
+    reference.configure(CLUSTER_TILES_X, CLUSTER_TILES_Y, CLUSTER_SLICES, 45.0f, 800.0f / 600.0f, 0.1f, 100.0f);
+    for (size_t lightCount : {100, 1000, 10000}) {
+        std::vector<PointLight> lights = generatePointLights(lightCount, 10.0f, 42);
+        const int repeats = 20;
+        auto assignStart = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeats; ++r) grid.assign(lights, view);
+        double assignMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - assignStart).count() / repeats;
+
+        reference.assignBruteForce(lights, view);
+        bool same = grid.clusterRanges() == reference.clusterRanges() && grid.lightIndices() == reference.lightIndices();
+        ok = ok && same;
+        std::cout << "clusters: " << lightCount << " lights -> " << grid.lightIndices().size() << " light references in "
+                  << grid.clusterCount() << " clusters, assign " << assignMs << " ms, brute force "
+                  << (same ? "matches" : "MISMATCH") << std::endl;
+    }
+
+    // Очередь отрисовки: сборка кадра (ключи, поразрядная сортировка, партии, данные экземпляров)
+    // и сверка порядка с std::stable_sort
+    for (size_t objectCount : {1000, 10000, 100000}) {
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> depth(0.1f, 100.0f);
+        std::vector<uint32_t> state(objectCount * 3);
+        std::vector<float> depths(objectCount);
+        std::vector<Mat4> models(objectCount);
+        for (size_t i = 0; i < objectCount; ++i) {
+            state[i * 3] = rng() % 2;      // Программа
+            state[i * 3 + 1] = rng() % 8;  // Материал
+            state[i * 3 + 2] = rng() % 4;  // Сетка
+            depths[i] = depth(rng);
+            models[i] = mat4Multiply(mat4Translate(float(i % 100), float(i / 100 % 100), -depths[i]), mat4Rotate(float(i % 360), 0.0f, 1.0f, 0.0f));
+        }
+
+        RenderQueue queue;
+        const int repeats = 10;
+        auto queueStart = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeats; ++r) {
+            queue.clear();
+            for (size_t i = 0; i < objectCount; ++i) queue.submit(state[i * 3], state[i * 3 + 1], state[i * 3 + 2], depths[i], models[i]);
+            queue.build();
+        }
+        double queueMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - queueStart).count() / repeats;
+
+        std::vector<DrawItem> expected(objectCount);
+        for (size_t i = 0; i < objectCount; ++i) {
+            expected[i] = {makeSortKey(state[i * 3], state[i * 3 + 1], state[i * 3 + 2], depths[i]), uint32_t(i)};
+        }
+        auto sortStart = std::chrono::steady_clock::now();
+        std::stable_sort(expected.begin(), expected.end(), [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+        double stableSortMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sortStart).count();
+
+        std::vector<DrawItem> radix(objectCount), scratch;
+        for (size_t i = 0; i < objectCount; ++i) {
+            radix[i] = {makeSortKey(state[i * 3], state[i * 3 + 1], state[i * 3 + 2], depths[i]), uint32_t(i)};
+        }
+        sortStart = std::chrono::steady_clock::now();
+        radixSortDrawItems(radix, scratch);
+        double radixMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sortStart).count();
+
+        bool sameOrder = true;
+        for (size_t i = 0; i < objectCount; ++i) {
+            sameOrder = sameOrder && radix[i].object == expected[i].object && queue.items()[i].object == expected[i].object;
+        }
+        ok = ok && sameOrder;
+
+        // Вызовов на объект без очереди: программа, 7 uniform-переменных, VAO, отрисовка
+        const SubmissionCounts& counts = queue.counts();
+        std::cout << "render queue: " << objectCount << " objects -> " << counts.batches << " batches, build " << queueMs
+                  << " ms (radix sort " << radixMs << " ms, std::stable_sort " << stableSortMs << " ms, order "
+                  << (sameOrder ? "matches" : "MISMATCH") << "); GL calls: " << objectCount * 10 << " unsorted vs "
+                  << counts.programChanges + 2 * counts.materialChanges + 2 * counts.batches << " instanced, "
+                  << counts.programChanges + 2 * counts.materialChanges + counts.indirectDraws << " indirect" << std::endl;
+    }
+
+    return ok ? 0 : 1;
+}
+
+// Поле из columns x rows пирамид с разными поворотами в плоскости z = 0 — сцена для замера пропускной способности
+Mesh buildPyramidField(const Mesh& pyramid, int columns, int rows, float width, float height) {
+    Mesh field;
+    field.vertices.reserve(pyramid.vertices.size() * size_t(columns) * size_t(rows));
+    field.indices.reserve(pyramid.indices.size() * size_t(columns) * size_t(rows));
+    const float cell = std::min(width / float(columns), height / float(rows));
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < columns; ++c) {
+            Mat4 rotation = mat4Multiply(mat4Rotate(float(r * 37 % 360), 1.0f, 0.0f, 0.0f), mat4Rotate(float(c * 53 % 360), 0.0f, 1.0f, 0.0f));
+            Mat4 model = mat4Multiply(mat4Translate(-0.5f * width + (float(c) + 0.5f) * cell, -0.5f * height + (float(r) + 0.5f) * cell, 0.0f),
+                                      mat4Multiply(mat4Scale(cell, cell, cell), rotation));
+            const uint32_t base = uint32_t(field.vertices.size());
+            for (const RawVertex& v : pyramid.vertices) {
+                RawVertex placed = v;
+                Vec4 p = mat4Transform(model, {v.position[0], v.position[1], v.position[2], 1.0f});
+                Vec4 n = mat4Transform(rotation, {v.normal[0], v.normal[1], v.normal[2], 0.0f});
+                placed.position[0] = p.x; placed.position[1] = p.y; placed.position[2] = p.z;
+                placed.normal[0] = n.x; placed.normal[1] = n.y; placed.normal[2] = n.z;
+                field.vertices.push_back(placed);
+            }
+            for (uint32_t index : pyramid.indices) field.indices.push_back(base + index);
+        }
+    }
+    return field;
+}
+
+// Многократная смена числа потоков вперемешку с parallelFor: каждый индекс должен быть
+// обработан ровно один раз, а parallelFor — вернуться только после завершения всех задач
+bool checkWorkerPoolResize() {
+    WorkerPool pool;
+    std::vector<std::atomic<int>> visits(256);
+    std::atomic<int> running{0};
+    for (int round = 0; round < 200; ++round) {
+        pool.resize(1 + unsigned(round) % 8);
+        for (int job = 0; job < 3; ++job) {
+            for (std::atomic<int>& v : visits) v.store(0);
+            pool.parallelFor(visits.size(), [&](size_t i, unsigned) {
+                running.fetch_add(1);
+                std::this_thread::yield();  // Дает другим потокам вклиниться посреди задачи
+                visits[i].fetch_add(1);
+                running.fetch_sub(1);
+            });
+            bool match = running.load() == 0;
+            for (const std::atomic<int>& v : visits) match = match && v.load() == 1;
+            if (!match) {
+                std::cout << "worker pool: round " << round << ", job " << job << " -> MISMATCH" << std::endl;
+                return false;
+            }
+        }
+    }
+    std::cout << "worker pool: 200 resizes x 3 jobs -> ok" << std::endl;
+    return true;
+}
+
+// Отрисовка без GPU: ./app --software [file.ppm]. Кадр сверяется с независимым эталоном
+// renderReference (отдельная реализация в double), затем замеряется число треугольников в секунду
+// на 1, 2, 4 и 8 потоках.
+int runSoftwareRenderer(const char* outputPath) {
+    const int width = 800, height = 600;
+    const int tolerance = 2;                   // Допустимое отличие канала (из 255)
+    // Допустимая доля отличающихся пикселей: float и double по-разному решают пиксели, центр
+    // которых почти на общем ребре, и почти совпадающие по глубине грани (в поле пирамид ~0.2%)
+    const double maxDifferentFraction = 0.005;
+    bool ok = true;
+
+    const RawVertex* raw = reinterpret_cast<const RawVertex*>(vertices);
+    Mesh pyramid = deduplicateVertices(raw, indices, sizeof(indices) / sizeof(indices[0]));
+    Mat4 model = mat4Multiply(mat4Rotate(angleX, 1.0f, 0.0f, 0.0f), mat4Rotate(angleY, 0.0f, 1.0f, 0.0f));
+    Mat4 view = mat4LookAt(viewPos.x, viewPos.y, viewPos.z, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+    Mat4 projection = mat4Perspective(45.0f, float(width) / float(height), 0.1f, 100.0f);
+    PhongParams phong = {{lightPos.x, lightPos.y, lightPos.z}, {viewPos.x, viewPos.y, viewPos.z}, specularPower, specularIntensity};
+
+    auto compare = [&](const char* name, const SoftFramebuffer& image, const SoftFramebuffer& reference) {
+        int maxDifference = 0;
+        size_t different = countDifferentPixels(image, reference, tolerance, &maxDifference);
+        bool match = double(different) <= maxDifferentFraction * double(width) * double(height);
+        std::cout << name << ": " << different << " pixels differ from the double-precision reference by more than " << tolerance
+                  << " (max difference " << maxDifference << ") -> " << (match ? "ok" : "MISMATCH") << std::endl;
+        ok = ok && match;
+    };
+
+    ok = checkWorkerPoolResize() && ok;
+
+    // Пирамида lab4 в исходном положении
+    unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+    SoftRasterizer rasterizer(threads);
+    SoftFramebuffer image, reference;
+    image.resize(width, height);
+    reference.resize(width, height);
+    image.clear(0.1f, 0.1f, 0.1f);
+    reference.clear(0.1f, 0.1f, 0.1f);
+    rasterizer.draw(pyramid, model, view, projection, phong, image);
+    renderReference(pyramid, model, view, projection, phong, reference);
+    compare("pyramid", image, reference);
+    if (!image.writePPM(outputPath)) {
+        std::cout << "Failed to write " << outputPath << std::endl;
+        ok = false;
+    } else {
+        std::cout << "Wrote " << outputPath << " (" << width << "x" << height << ", " << threads << " threads)" << std::endl;
+    }
+
+    // Поле пирамид для замера пропускной способности
+    Mesh field = buildPyramidField(pyramid, 160, 120, 3.2f, 2.4f);
+    Mat4 identity = mat4Identity();
+    image.clear(0.1f, 0.1f, 0.1f);
+    reference.clear(0.1f, 0.1f, 0.1f);
+    rasterizer.draw(field, identity, view, projection, phong, image);
+    renderReference(field, identity, view, projection, phong, reference);
+    compare("pyramid field", image, reference);
+
+    const size_t triangles = field.indices.size() / 3;
+    const int frames = 10;
+    for (unsigned threadCount : {1u, 2u, 4u, 8u}) {
+        rasterizer.setThreads(threadCount);
+        double vertexMs = 0.0, setupMs = 0.0, rasterMs = 0.0;
+        auto start = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; ++f) {
+            image.clear(0.1f, 0.1f, 0.1f);
+            rasterizer.draw(field, identity, view, projection, phong, image);
+            vertexMs += rasterizer.stats().vertexMs;
+            setupMs += rasterizer.stats().setupMs;
+            rasterMs += rasterizer.stats().rasterMs;
+        }
+        double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+        std::cout << threadCount << " threads: " << frameMs << " ms/frame, " << triangles / frameMs / 1000.0
+                  << " M triangles/s (vertex " << vertexMs / frames << " ms, setup+binning " << setupMs / frames
+                  << " ms, raster " << rasterMs / frames << " ms; " << rasterizer.stats().binEntries << " bin entries)" << std::endl;
+    }
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--bench") == 0) {
+        return runBenchmark();
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--software") == 0) {
+        return runSoftwareRenderer(argc > 2 ? argv[2] : "software.ppm");
+    }
+
     glfwInit();  // Инициализация GLFW
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -179,29 +878,117 @@ int main() {
 
     glewInit();  // Инициализация GLEW
 
-    // Создание шейдерной программы
+    // --clear-shader-cache: замер холодного запуска; --mesh-stats: сравнение загрузки сетки
+    // --lights N: число дополнительных точечных источников; --objects N: число дополнительных объектов;
+    // --no-indirect: инстансинг вместо multi-draw-indirect
+    bool measureMeshUpload = false;
+    bool useIndirectDraws = true;
+    size_t lightCount = 0;
+    size_t objectCount = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--clear-shader-cache") == 0) programCache.clear();
+        if (std::strcmp(argv[i], "--mesh-stats") == 0) measureMeshUpload = true;
+        if (std::strcmp(argv[i], "--no-indirect") == 0) useIndirectDraws = false;
+        if (std::strcmp(argv[i], "--lights") == 0 && i + 1 < argc) lightCount = size_t(std::strtoul(argv[++i], nullptr, 10));
+        if (std::strcmp(argv[i], "--objects") == 0 && i + 1 < argc) objectCount = size_t(std::strtoul(argv[++i], nullptr, 10));
+    }
+
+    // Создание шейдерной программы и однократный опрос ее uniform-переменных
     createShaderProgram();
+    program.reflect(shaderProgram);
+    program.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+    frameBuffer.create(sizeof(FrameData), FRAME_DATA_BINDING);
+
+    const ShaderProgram::Handle specularPowerUniform = program.handle("specularPower");
+    const ShaderProgram::Handle specularIntensityUniform = program.handle("specularIntensity");
+    const ShaderProgram::Handle meshScaleUniform = program.handle("meshScale");
+    const ShaderProgram::Handle meshOffsetUniform = program.handle("meshOffset");
+    const ShaderProgram::Handle pointLightsUniform = program.handle("pointLights");
+    const ShaderProgram::Handle clusterRangesUniform = program.handle("clusterRanges");
+    const ShaderProgram::Handle clusterIndicesUniform = program.handle("clusterLightIndices");
+    const ShaderProgram::Handle clusterGridUniform = program.handle("clusterGrid");
+    const ShaderProgram::Handle clusterParamsUniform = program.handle("clusterParams");
+
+    // Подготовка сетки: загрузка готового файла или импорт из массива вершин
+    const uint64_t meshSourceHash = sceneMeshSourceHash();
+    if (!loadMesh(MESH_FILE, mesh, meshSourceHash)) {
+        mesh = buildSceneMesh();
+        if (!saveMesh(MESH_FILE, mesh, meshSourceHash)) std::cout << "Failed to write " << MESH_FILE << std::endl;
+    }
+    std::string rangeError;
+    if (!validateDrawRange(mesh.vertices.size(), mesh.indices, mesh.indices.size(), &rangeError)) {
+        std::cout << "Invalid mesh: " << rangeError << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+
+    if (measureMeshUpload) measureRawUpload();
 
     // Генерация VAO, VBO и EBO
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
 
+    glFinish();
+    auto uploadStart = std::chrono::steady_clock::now();
     glBindVertexArray(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(PackedVertex), mesh.vertices.data(), GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(uint32_t), mesh.indices.data(), GL_STATIC_DRAW);
+
+    setupPackedVertexAttributes();
+    setupInstanceAttributes();
+
+    glBindVertexArray(0);
+    glFinish();
+    double uploadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - uploadStart).count();
+    std::cout << "Packed mesh: " << mesh.vertices.size() << " vertices x " << sizeof(PackedVertex) << " bytes, "
+              << mesh.vertices.size() * sizeof(PackedVertex) + mesh.indices.size() * sizeof(uint32_t)
+              << " bytes total, upload " << uploadMs << " ms" << std::endl;
+
+    // Видовая и проекционная матрицы не меняются между кадрами, строим их один раз
+    Mat4 view = mat4LookAt(viewPos.x, viewPos.y, viewPos.z, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);  // Камера
+    Mat4 projection = mat4Perspective(45.0f, 800.0f / 600.0f, 0.1f, 100.0f);  // Перспективная проекция
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*)(6 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(2);
+    FrameData frame = {};
+    std::memcpy(frame.view, view.m, sizeof(frame.view));
+    std::memcpy(frame.projection, projection.m, sizeof(frame.projection));
 
-    glBindVertexArray(0); 
+    // Точечные источники неподвижны в мире, а камера не движется: распределение по кластерам
+    // считается один раз и загружается в текстурные буферы
+    pointLights = generatePointLights(lightCount, 3.0f, 42);
+    lightGrid.configure(CLUSTER_TILES_X, CLUSTER_TILES_Y, CLUSTER_SLICES, 45.0f, 800.0f / 600.0f, 0.1f, 100.0f);
+    auto assignStart = std::chrono::steady_clock::now();
+    lightGrid.assign(pointLights, view);
+    double assignMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - assignStart).count();
+
+    pointLightBuffer.create(GL_RGBA32F, POINT_LIGHTS_UNIT);
+    clusterRangeBuffer.create(GL_RG32UI, CLUSTER_RANGES_UNIT);
+    clusterIndexBuffer.create(GL_R32UI, CLUSTER_INDICES_UNIT);
+    pointLightBuffer.upload(pointLights.data(), pointLights.size() * sizeof(PointLight));
+    clusterRangeBuffer.upload(lightGrid.clusterRanges().data(), lightGrid.clusterRanges().size() * sizeof(uint32_t));
+    clusterIndexBuffer.upload(lightGrid.lightIndices().data(), lightGrid.lightIndices().size() * sizeof(uint32_t));
+    if (lightCount > 0) {
+        std::cout << "Point lights: " << lightCount << ", " << lightGrid.lightIndices().size() << " light references in "
+                  << lightGrid.clusterCount() << " clusters, assigned in " << assignMs << " ms" << std::endl;
+    }
+    const float clusterGrid[4] = {float(lightGrid.tilesX()), float(lightGrid.tilesY()), float(lightGrid.slices()), 0.0f};
+
+    // Материалы и объекты сцены; multi-draw-indirect, если драйвер его поддерживает (GL 4.3).
+    // Команды партий начинаются с ненулевого baseInstance, а без ARB_base_instance (GL 4.2) он
+    // игнорируется и все партии читали бы атрибуты с экземпляра 0 — тогда остается инстансинг
+    materials = {{specularPower, specularIntensity}, {8.0f, 0.3f}, {64.0f, 1.0f}, {128.0f, 0.6f}};
+    sceneObjects = generateSceneObjects(objectCount, 7);
+    const bool useIndirect = useIndirectDraws && GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance;
+    if (useIndirect) glGenBuffers(1, &indirectBuffer);
+    std::cout << "Scene: " << sceneObjects.size() + 1 << " objects, "
+              << (useIndirect ? "multi-draw-indirect" : "instanced draws") << std::endl;
+    uint64_t frameIndex = 0;
+
+    GLCallStats statsTotal;  // Накопленные счетчики для вывода средних значений за кадр
+    int statsFrames = 0;
 
     // Основной цикл
     while (!glfwWindowShouldClose(window)) {
@@ -211,27 +998,57 @@ int main() {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glEnable(GL_DEPTH_TEST);  // Включение глубинного теста
 
-        // Преобразования: модельная, видовая и проекционная матрица
-        glm::mat4 model = glm::mat4(1.0f);  // Единичная матрица для модели
-        model = glm::rotate(model, glm::radians(angleX), glm::vec3(1.0f, 0.0f, 0.0f));  // Вращение по оси X
-        model = glm::rotate(model, glm::radians(angleY), glm::vec3(0.0f, 1.0f, 0.0f));  // Вращение по оси Y
-
-        glm::mat4 view = glm::lookAt(viewPos, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));  // Камера
-        glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);  // Перспективная проекция
-
-        // Передача матриц и параметров в шейдеры
-        glUseProgram(shaderProgram);
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-        glUniform3fv(glGetUniformLocation(shaderProgram, "lightPos"), 1, glm::value_ptr(lightPos));
-        glUniform3fv(glGetUniformLocation(shaderProgram, "viewPos"), 1, glm::value_ptr(viewPos));
-        glUniform1f(glGetUniformLocation(shaderProgram, "specularPower"), specularPower);
-        glUniform1f(glGetUniformLocation(shaderProgram, "specularIntensity"), specularIntensity);
-
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);  // Рисование куба
-        glBindVertexArray(0);
+        // Очередь кадра: пирамида lab4 (вращение по оси X, затем по оси Y) и объекты сцены
+        renderQueue.clear();
+        Mat4 model = mat4Multiply(mat4Rotate(angleX, 1.0f, 0.0f, 0.0f), mat4Rotate(angleY, 0.0f, 1.0f, 0.0f));
+        renderQueue.submit(0, 0, MESH_PYRAMID, viewDepth(view, model), model);
+        const float spin = float(frameIndex++ % 720) * 0.5f;
+        for (const SceneObject& object : sceneObjects) {
+            Mat4 objectModel = mat4Multiply(mat4Translate(object.position[0], object.position[1], object.position[2]),
+                                            mat4Multiply(mat4Rotate(object.phase + spin, 0.0f, 1.0f, 0.0f),
+                                                         mat4Scale(object.scale, object.scale, object.scale)));
+            renderQueue.submit(0, object.material, object.mesh, viewDepth(view, objectModel), objectModel);
+        }
+        renderQueue.build();
+
+        // Данные кадра: буфер обновляется только если камера или свет сдвинулись
+        std::memcpy(frame.viewPos, glm::value_ptr(viewPos), 3 * sizeof(float));
+        std::memcpy(frame.lightPos, glm::value_ptr(lightPos), 3 * sizeof(float));
+        frameBuffer.update(&frame, sizeof(frame));
+
+        // Передача параметров в шейдеры: неизменившиеся значения не загружаются повторно
+        program.use();
+        program.setVec3(meshScaleUniform, mesh.positionScale);
+        program.setVec3(meshOffsetUniform, mesh.positionOffset);
+
+        // Размер кадра нужен шейдеру для выбора плитки по gl_FragCoord
+        int framebufferWidth = 0, framebufferHeight = 0;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        const float clusterParams[4] = {float(std::max(framebufferWidth, 1)), float(std::max(framebufferHeight, 1)),
+                                        lightGrid.depthScale(), lightGrid.depthBias()};
+        program.setInt(pointLightsUniform, POINT_LIGHTS_UNIT);
+        program.setInt(clusterRangesUniform, CLUSTER_RANGES_UNIT);
+        program.setInt(clusterIndicesUniform, CLUSTER_INDICES_UNIT);
+        program.setVec4(clusterGridUniform, clusterGrid);
+        program.setVec4(clusterParamsUniform, clusterParams);
+
+        submitRenderQueue(useIndirect, specularPowerUniform, specularIntensityUniform);
+
+        // Среднее число вызовов GL за кадр, раз в 300 кадров
+        statsTotal.add(glStats);
+        glStats.reset();
+        if (++statsFrames == 300) {
+            std::cout << "GL calls/frame: " << float(statsTotal.total()) / statsFrames
+                      << " (uniform uploads " << float(statsTotal.uniformUploads) / statsFrames
+                      << ", skipped " << float(statsTotal.uniformsSkipped) / statsFrames
+                      << "; buffer uploads " << float(statsTotal.bufferUploads) / statsFrames
+                      << ", skipped " << float(statsTotal.buffersSkipped) / statsFrames
+                      << "; draws " << float(statsTotal.drawCalls) / statsFrames
+                      << ", state changes " << float(statsTotal.stateChanges()) / statsFrames
+                      << ", instances " << float(statsTotal.instancesDrawn) / statsFrames << ")" << std::endl;
+            statsTotal.reset();
+            statsFrames = 0;
+        }
 
         glfwSwapBuffers(window);  // Обмен буферов
         glfwPollEvents();  // Обработка событий
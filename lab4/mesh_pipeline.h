@@ -0,0 +1,235 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Исходная вершина: позиция, цвет, нормаль — 9 float (36 байт)
+struct RawVertex {
+    float position[3];
+    float color[3];
+    float normal[3];
+};
+
+// Упакованная вершина (16 байт):
+// позиция — нормализованные 16-битные целые (w не используется, выравнивание до 8 байт),
+// нормаль — 10:10:10:2 со знаком (GL_INT_2_10_10_10_REV), цвет — RGBA8
+struct PackedVertex {
+    int16_t position[4];
+    uint32_t normal;
+    uint8_t color[4];
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+// Часть общего буфера: диапазон индексов одной сетки (индексы уже указывают на общие вершины)
+struct SubMesh {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+
+    bool operator==(const SubMesh& o) const { return firstIndex == o.firstIndex && indexCount == o.indexCount; }
+};
+
+struct Mesh {
+    std::vector<RawVertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<SubMesh> subMeshes;  // Пусто — вся сетка как одна часть
+};
+
+// Позиции хранятся в диапазоне [-1, 1]; исходная позиция = packed * positionScale + positionOffset.
+// Все части квантуются с общим масштабом, поэтому рисуются из одного буфера без смены uniform-переменных.
+struct PackedMesh {
+    std::vector<PackedVertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<SubMesh> subMeshes;
+    float positionScale[3] = {1.0f, 1.0f, 1.0f};
+    float positionOffset[3] = {0.0f, 0.0f, 0.0f};
+};
+
+// Слияние побитово одинаковых вершин и построение настоящего индексного буфера
+inline Mesh deduplicateVertices(const RawVertex* vertices, const uint32_t* indices, size_t indexCount) {
+    std::unordered_map<std::string, uint32_t> unique;  // Байты вершины -> ее новый индекс
+
+    Mesh mesh;
+    mesh.indices.reserve(indexCount);
+    for (size_t i = 0; i < indexCount; ++i) {
+        const RawVertex& v = vertices[indices[i]];
+        std::string key(reinterpret_cast<const char*>(&v), sizeof(RawVertex));
+        auto it = unique.find(key);
+        if (it == unique.end()) {
+            it = unique.emplace(key, uint32_t(mesh.vertices.size())).first;
+            mesh.vertices.push_back(v);
+        }
+        mesh.indices.push_back(it->second);
+    }
+    return mesh;
+}
+
+// Добавление сетки в общий буфер сцены; возвращает номер новой части
+inline uint32_t appendSubMesh(Mesh& scene, const Mesh& part) {
+    const uint32_t base = uint32_t(scene.vertices.size());
+    scene.subMeshes.push_back({uint32_t(scene.indices.size()), uint32_t(part.indices.size())});
+    scene.vertices.insert(scene.vertices.end(), part.vertices.begin(), part.vertices.end());
+    for (uint32_t index : part.indices) scene.indices.push_back(base + index);
+    return uint32_t(scene.subMeshes.size() - 1);
+}
+
+// Проверка диапазона отрисовки: число индексов не больше буфера и кратно 3, индексы в пределах вершин
+inline bool validateDrawRange(size_t vertexCount, const std::vector<uint32_t>& indices, size_t drawCount, std::string* error) {
+    if (drawCount > indices.size()) {
+        if (error) *error = "draw count " + std::to_string(drawCount) + " exceeds index buffer of " + std::to_string(indices.size());
+        return false;
+    }
+    if (drawCount % 3 != 0) {
+        if (error) *error = "draw count " + std::to_string(drawCount) + " is not a multiple of 3";
+        return false;
+    }
+    for (size_t i = 0; i < drawCount; ++i) {
+        if (indices[i] >= vertexCount) {
+            if (error) *error = "index " + std::to_string(indices[i]) + " at " + std::to_string(i) + " is out of " + std::to_string(vertexCount) + " vertices";
+            return false;
+        }
+    }
+    return true;
+}
+
+inline int16_t packSnorm16(float v) {
+    return int16_t(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+inline uint32_t packSnorm10(float v) {
+    return uint32_t(std::lround(std::clamp(v, -1.0f, 1.0f) * 511.0f)) & 0x3FFu;
+}
+
+inline uint8_t packUnorm8(float v) {
+    return uint8_t(std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f));
+}
+
+inline PackedMesh packMesh(const Mesh& mesh) {
+    PackedMesh packed;
+    packed.indices = mesh.indices;
+    packed.subMeshes = mesh.subMeshes;
+    if (packed.subMeshes.empty()) packed.subMeshes.push_back({0, uint32_t(mesh.indices.size())});
+    if (mesh.vertices.empty()) return packed;
+
+    // Границы модели задают масштаб и смещение квантования
+    float minP[3], maxP[3];
+    for (int k = 0; k < 3; ++k) minP[k] = maxP[k] = mesh.vertices[0].position[k];
+    for (const RawVertex& v : mesh.vertices) {
+        for (int k = 0; k < 3; ++k) {
+            minP[k] = std::min(minP[k], v.position[k]);
+            maxP[k] = std::max(maxP[k], v.position[k]);
+        }
+    }
+    for (int k = 0; k < 3; ++k) {
+        packed.positionOffset[k] = 0.5f * (minP[k] + maxP[k]);
+        packed.positionScale[k] = std::max(0.5f * (maxP[k] - minP[k]), 1e-6f);
+    }
+
+    packed.vertices.reserve(mesh.vertices.size());
+    for (const RawVertex& v : mesh.vertices) {
+        PackedVertex p = {};
+        for (int k = 0; k < 3; ++k) {
+            p.position[k] = packSnorm16((v.position[k] - packed.positionOffset[k]) / packed.positionScale[k]);
+        }
+
+        float nx = v.normal[0], ny = v.normal[1], nz = v.normal[2];
+        float length = std::sqrt(nx * nx + ny * ny + nz * nz);
+        if (length > 0.0f) { nx /= length; ny /= length; nz /= length; }
+        p.normal = packSnorm10(nx) | (packSnorm10(ny) << 10) | (packSnorm10(nz) << 20);
+
+        for (int k = 0; k < 3; ++k) p.color[k] = packUnorm8(v.color[k]);
+        p.color[3] = 255;
+        packed.vertices.push_back(p);
+    }
+    return packed;
+}
+
+// Форматы атрибутов для упакованных вершин (те же location, что и в вершинном шейдере)
+inline void setupPackedVertexAttributes() {
+    const GLsizei stride = sizeof(PackedVertex);
+    glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, stride, (GLvoid*)offsetof(PackedVertex, position));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (GLvoid*)offsetof(PackedVertex, color));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (GLvoid*)offsetof(PackedVertex, normal));
+    glEnableVertexAttribArray(2);
+}
+
+// FNV-1a по байтам исходных данных сетки; вызовы сцепляются через hash, чтобы ключ
+// покрывал несколько массивов
+constexpr uint64_t MESH_SOURCE_HASH_SEED = 14695981039346656037ull;
+
+inline uint64_t hashMeshSource(const void* data, size_t size, uint64_t hash = MESH_SOURCE_HASH_SEED) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline uint64_t hashMeshSource(const Mesh& mesh, uint64_t hash = MESH_SOURCE_HASH_SEED) {
+    hash = hashMeshSource(mesh.vertices.data(), mesh.vertices.size() * sizeof(RawVertex), hash);
+    hash = hashMeshSource(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t), hash);
+    return hashMeshSource(mesh.subMeshes.data(), mesh.subMeshes.size() * sizeof(SubMesh), hash);
+}
+
+// Компактный бинарный файл сетки: заголовок, вершины, индексы, таблица частей.
+// sourceHash — ключ исходных данных, из которых файл собран: при его несовпадении файл устарел.
+struct MeshFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceHash;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t subMeshCount;
+    float positionScale[3];
+    float positionOffset[3];
+};
+
+constexpr uint32_t MESH_FILE_MAGIC = 0x534D4743;  // "CGMS"
+constexpr uint32_t MESH_FILE_VERSION = 3;
+
+inline bool saveMesh(const std::string& path, const PackedMesh& mesh, uint64_t sourceHash) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+    MeshFileHeader header = {MESH_FILE_MAGIC, MESH_FILE_VERSION, sourceHash, uint32_t(mesh.vertices.size()), uint32_t(mesh.indices.size()),
+                             uint32_t(mesh.subMeshes.size()), {}, {}};
+    std::memcpy(header.positionScale, mesh.positionScale, sizeof(header.positionScale));
+    std::memcpy(header.positionOffset, mesh.positionOffset, sizeof(header.positionOffset));
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(mesh.vertices.data()), std::streamsize(mesh.vertices.size() * sizeof(PackedVertex)));
+    file.write(reinterpret_cast<const char*>(mesh.indices.data()), std::streamsize(mesh.indices.size() * sizeof(uint32_t)));
+    file.write(reinterpret_cast<const char*>(mesh.subMeshes.data()), std::streamsize(mesh.subMeshes.size() * sizeof(SubMesh)));
+    return bool(file);
+}
+
+// false — файла нет, он поврежден или собран из других исходных данных (sourceHash не совпал)
+inline bool loadMesh(const std::string& path, PackedMesh& mesh, uint64_t sourceHash) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    MeshFileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    if (header.magic != MESH_FILE_MAGIC || header.version != MESH_FILE_VERSION || header.sourceHash != sourceHash) return false;
+
+    mesh.vertices.resize(header.vertexCount);
+    mesh.indices.resize(header.indexCount);
+    mesh.subMeshes.resize(header.subMeshCount);
+    std::memcpy(mesh.positionScale, header.positionScale, sizeof(mesh.positionScale));
+    std::memcpy(mesh.positionOffset, header.positionOffset, sizeof(mesh.positionOffset));
+    file.read(reinterpret_cast<char*>(mesh.vertices.data()), std::streamsize(mesh.vertices.size() * sizeof(PackedVertex)));
+    file.read(reinterpret_cast<char*>(mesh.indices.data()), std::streamsize(mesh.indices.size() * sizeof(uint32_t)));
+    file.read(reinterpret_cast<char*>(mesh.subMeshes.data()), std::streamsize(mesh.subMeshes.size() * sizeof(SubMesh)));
+    if (!file || mesh.subMeshes.empty()) return false;
+    for (const SubMesh& part : mesh.subMeshes) {
+        if (part.firstIndex % 3 != 0 || part.indexCount % 3 != 0 || uint64_t(part.firstIndex) + part.indexCount > mesh.indices.size()) return false;
+    }
+    return validateDrawRange(mesh.vertices.size(), mesh.indices, mesh.indices.size(), nullptr);
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Дисковый кэш бинарников шейдерных программ (glGetProgramBinary / glProgramBinary).
+// Ключ — хэш исходников, define-ов и строк драйвера: после обновления драйвера
+// или смены видеокарты ключ меняется, и программа собирается заново.
+class ProgramCache {
+public:
+    explicit ProgramCache(std::string directory) : directory_(std::move(directory)) {}
+
+    // Драйвер должен поддерживать хотя бы один формат бинарника (на macOS их может не быть)
+    bool supported() const {
+        if (!GLEW_ARB_get_program_binary) return false;
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    uint64_t makeKey(const char* vertexSource, const char* fragmentSource, const std::string& defines) const {
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&](const char* text) {
+            // FNV-1a, нулевой байт разделяет части ключа
+            for (const char* c = text ? text : ""; ; ++c) {
+                hash ^= uint8_t(*c);
+                hash *= 1099511628211ull;
+                if (*c == '\0') break;
+            }
+        };
+        mix(vertexSource);
+        mix(fragmentSource);
+        mix(defines.c_str());
+        mix(reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+        mix(reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+        mix(reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+        return hash;
+    }
+
+    // Загрузка программы из кэша; 0 — записи нет или драйвер отверг бинарник (запись удаляется)
+    GLuint load(uint64_t key) const {
+        std::ifstream file(pathFor(key), std::ios::binary);
+        if (!file) return 0;
+
+        Header header;
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            header.magic != MAGIC || header.version != VERSION || header.key != key) {
+            file.close();
+            remove(key);
+            return 0;
+        }
+        std::vector<char> binary(header.length);
+        if (!file.read(binary.data(), std::streamsize(binary.size()))) {
+            file.close();
+            remove(key);
+            return 0;
+        }
+
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, GLenum(header.format), binary.data(), GLsizei(binary.size()));
+        GLint success = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            // Формат не совпал с текущим драйвером: сборка из исходников перезапишет кэш
+            glDeleteProgram(program);
+            file.close();
+            remove(key);
+            return 0;
+        }
+        return program;
+    }
+
+    // Сохранение слинкованной программы (перед линковкой нужен GL_PROGRAM_BINARY_RETRIEVABLE_HINT)
+    bool store(uint64_t key, GLuint program) const {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return false;
+
+        std::vector<char> binary(static_cast<size_t>(length));
+        GLenum format = 0;
+        glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+        std::error_code error;
+        std::filesystem::create_directories(directory_, error);
+        std::ofstream file(pathFor(key), std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+
+        Header header = {MAGIC, VERSION, key, uint32_t(format), uint32_t(length)};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), std::streamsize(binary.size()));
+        return bool(file);
+    }
+
+    void clear() const {
+        std::error_code error;
+        std::filesystem::remove_all(directory_, error);
+    }
+
+private:
+    static constexpr uint32_t MAGIC = 0x42504743;  // "CGPB"
+    static constexpr uint32_t VERSION = 1;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint32_t format;
+        uint32_t length;
+    };
+
+    std::string pathFor(uint64_t key) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+        return directory_ + "/" + name;
+    }
+
+    void remove(uint64_t key) const {
+        std::error_code error;
+        std::filesystem::remove(pathFor(key), error);
+    }
+
+    std::string directory_;
+};
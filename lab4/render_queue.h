@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "../common/cpu_math.h"
+
+// Ключ сортировки объекта: программа (8 бит) | материал (12 бит) | сетка (12 бит) | глубина (32 бита).
+// Старшие поля — самые дорогие переключения состояния, глубина упорядочивает объекты спереди назад.
+inline uint64_t makeSortKey(uint32_t program, uint32_t material, uint32_t mesh, float depth) {
+    depth = std::max(depth, 0.0f);  // Неотрицательные float сравниваются как целые той же разрядности
+    uint32_t depthBits;
+    std::memcpy(&depthBits, &depth, sizeof(depthBits));
+    return (uint64_t(program & 0xFFu) << 56) | (uint64_t(material & 0xFFFu) << 44) | (uint64_t(mesh & 0xFFFu) << 32) | depthBits;
+}
+
+inline uint32_t sortKeyProgram(uint64_t key) { return uint32_t(key >> 56); }
+inline uint32_t sortKeyMaterial(uint64_t key) { return uint32_t(key >> 44) & 0xFFFu; }
+inline uint32_t sortKeyMesh(uint64_t key) { return uint32_t(key >> 32) & 0xFFFu; }
+
+struct DrawItem {
+    uint64_t key;
+    uint32_t object;  // Номер объекта в порядке добавления
+};
+
+// Поразрядная сортировка (LSD, 8 проходов по байту). Устойчива: объекты с равными ключами
+// остаются в порядке добавления. Проходы, где у всех ключей одинаковый байт, пропускаются.
+inline void radixSortDrawItems(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch) {
+    const size_t count = items.size();
+    if (count < 2) return;
+    scratch.resize(count);
+
+    std::vector<uint32_t> histogram(8 * 256, 0);
+    for (const DrawItem& item : items) {
+        for (int b = 0; b < 8; ++b) histogram[b * 256 + ((item.key >> (b * 8)) & 0xFFu)]++;
+    }
+
+    DrawItem* source = items.data();
+    DrawItem* target = scratch.data();
+    for (int b = 0; b < 8; ++b) {
+        uint32_t* digits = &histogram[b * 256];
+        if (digits[(source[0].key >> (b * 8)) & 0xFFu] == count) continue;
+        uint32_t offset = 0;
+        for (int d = 0; d < 256; ++d) {
+            uint32_t n = digits[d];
+            digits[d] = offset;
+            offset += n;
+        }
+        for (size_t i = 0; i < count; ++i) target[digits[(source[i].key >> (b * 8)) & 0xFFu]++] = source[i];
+        std::swap(source, target);
+    }
+    if (source != items.data()) items.swap(scratch);
+}
+
+// Партия: подряд идущие после сортировки объекты с одинаковыми программой, материалом и сеткой
+struct DrawBatch {
+    uint32_t program;
+    uint32_t material;
+    uint32_t mesh;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+};
+
+// Сколько переключений состояния требует отсортированный список партий
+struct SubmissionCounts {
+    size_t batches = 0;
+    size_t programChanges = 0;
+    size_t materialChanges = 0;
+    size_t meshChanges = 0;
+    size_t indirectDraws = 0;  // Серии партий с одинаковыми программой и материалом
+};
+
+// Очередь отрисовки: объекты собираются за кадр, сортируются по ключу и превращаются в партии.
+// Данные экземпляров (модельная матрица и матрица нормалей) пишутся в один массив в порядке
+// отрисовки — его целиком загружает в потоковый буфер один вызов за кадр.
+class RenderQueue {
+public:
+    // mat4 модели + три столбца mat3 нормалей, дополненные до vec4 (112 байт на объект)
+    static constexpr size_t INSTANCE_FLOATS = 28;
+
+    void clear() {
+        items_.clear();
+        models_.clear();
+    }
+
+    void submit(uint32_t program, uint32_t material, uint32_t mesh, float depth, const Mat4& model) {
+        items_.push_back({makeSortKey(program, material, mesh, depth), uint32_t(models_.size())});
+        models_.push_back(model);
+    }
+
+    void build() {
+        radixSortDrawItems(items_, scratch_);
+
+        batches_.clear();
+        counts_ = SubmissionCounts();
+        instanceData_.resize(items_.size() * INSTANCE_FLOATS);
+        uint64_t previousState = ~0ull;
+        for (size_t i = 0; i < items_.size(); ++i) {
+            const Mat4& model = models_[items_[i].object];
+            float* instance = &instanceData_[i * INSTANCE_FLOATS];
+            std::memcpy(instance, model.m, sizeof(model.m));
+            Mat3 normal = mat4NormalMatrix(model);
+            for (int c = 0; c < 3; ++c) {
+                std::memcpy(instance + 16 + c * 4, normal.m + c * 3, 3 * sizeof(float));
+                instance[16 + c * 4 + 3] = 0.0f;
+            }
+
+            const uint64_t key = items_[i].key;
+            const uint64_t state = key >> 32;  // Все поля, кроме глубины
+            if (state == previousState) {
+                batches_.back().instanceCount++;
+                continue;
+            }
+            const DrawBatch batch = {sortKeyProgram(key), sortKeyMaterial(key), sortKeyMesh(key), uint32_t(i), 1};
+            const bool programChanged = batches_.empty() || batches_.back().program != batch.program;
+            const bool materialChanged = batches_.empty() || batches_.back().material != batch.material;
+            if (programChanged) counts_.programChanges++;
+            if (materialChanged) counts_.materialChanges++;
+            if (programChanged || materialChanged) counts_.indirectDraws++;
+            if (batches_.empty() || batches_.back().mesh != batch.mesh) counts_.meshChanges++;
+            batches_.push_back(batch);
+            previousState = state;
+        }
+        counts_.batches = batches_.size();
+    }
+
+    size_t size() const { return items_.size(); }
+    const std::vector<DrawItem>& items() const { return items_; }
+    const std::vector<DrawBatch>& batches() const { return batches_; }
+    const std::vector<float>& instanceData() const { return instanceData_; }
+    const SubmissionCounts& counts() const { return counts_; }
+
+private:
+    std::vector<DrawItem> items_, scratch_;
+    std::vector<Mat4> models_;
+    std::vector<DrawBatch> batches_;
+    std::vector<float> instanceData_;
+    SubmissionCounts counts_;
+};
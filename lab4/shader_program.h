@@ -0,0 +1,191 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Счетчики вызовов GL за кадр: сколько реально ушло в драйвер и сколько пропущено
+struct GLCallStats {
+    unsigned programBinds = 0;
+    unsigned uniformUploads = 0;
+    unsigned uniformsSkipped = 0;
+    unsigned bufferUploads = 0;
+    unsigned buffersSkipped = 0;
+    unsigned vertexArrayBinds = 0;
+    unsigned attributeBinds = 0;   // Перенастройка указателей атрибутов экземпляров
+    unsigned drawCalls = 0;
+    unsigned instancesDrawn = 0;
+
+    // Переключения состояния конвейера между вызовами отрисовки
+    unsigned stateChanges() const { return programBinds + uniformUploads + vertexArrayBinds + attributeBinds; }
+    unsigned total() const { return stateChanges() + bufferUploads + drawCalls; }
+    void reset() { *this = GLCallStats(); }
+
+    void add(const GLCallStats& o) {
+        programBinds += o.programBinds;
+        uniformUploads += o.uniformUploads;
+        uniformsSkipped += o.uniformsSkipped;
+        bufferUploads += o.bufferUploads;
+        buffersSkipped += o.buffersSkipped;
+        vertexArrayBinds += o.vertexArrayBinds;
+        attributeBinds += o.attributeBinds;
+        drawCalls += o.drawCalls;
+        instancesDrawn += o.instancesDrawn;
+    }
+};
+
+inline GLCallStats glStats;
+
+// Обертка над слинкованной программой: все активные uniform-переменные опрашиваются
+// один раз после линковки, дальше загрузка идет по кэшированным location и
+// пропускается, если значение не изменилось с прошлой загрузки.
+class ShaderProgram {
+public:
+    using Handle = int;  // Индекс uniform-переменной в кэше, -1 — переменная не активна
+
+    ShaderProgram() = default;
+    explicit ShaderProgram(GLuint program) { reflect(program); }
+
+    void reflect(GLuint program) {
+        program_ = program;
+        uniforms_.clear();
+        lookup_.clear();
+
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<char> name(maxLength > 0 ? maxLength : 1);
+
+        for (GLint i = 0; i < count; ++i) {
+            GLsizei length = 0;
+            Uniform uniform;
+            glGetActiveUniform(program, GLuint(i), GLsizei(name.size()), &length, &uniform.size, &uniform.type, name.data());
+            uniform.location = glGetUniformLocation(program, name.data());
+            if (uniform.location < 0) continue;  // Переменные из uniform-блоков загружаются через буфер
+
+            std::string key(name.data(), length);
+            size_t bracket = key.find('[');  // Массивы приходят как "name[0]"
+            if (bracket != std::string::npos) key.resize(bracket);
+
+            lookup_[key] = Handle(uniforms_.size());
+            uniforms_.push_back(uniform);
+        }
+    }
+
+    GLuint id() const { return program_; }
+
+    Handle handle(const char* name) const {
+        auto it = lookup_.find(name);
+        return it == lookup_.end() ? -1 : it->second;
+    }
+
+    // Переключение программы только если активна другая
+    void use() const {
+        if (currentProgram() == program_) return;
+        glUseProgram(program_);
+        currentProgram() = program_;
+        glStats.programBinds++;
+    }
+
+    void setMat4(Handle h, const float* value) {
+        if (changed(h, value, 16)) glUniformMatrix4fv(uniforms_[h].location, 1, GL_FALSE, value);
+    }
+
+    void setVec3(Handle h, const float* value) {
+        if (changed(h, value, 3)) glUniform3fv(uniforms_[h].location, 1, value);
+    }
+
+    void setVec4(Handle h, const float* value) {
+        if (changed(h, value, 4)) glUniform4fv(uniforms_[h].location, 1, value);
+    }
+
+    void setFloat(Handle h, float value) {
+        if (changed(h, &value, 1)) glUniform1f(uniforms_[h].location, value);
+    }
+
+    // Целые значения (номера текстурных блоков для сэмплеров) кэшируются побитово
+    void setInt(Handle h, int value) {
+        float bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        if (changed(h, &bits, 1)) glUniform1i(uniforms_[h].location, value);
+    }
+
+    // Привязка uniform-блока программы к общей точке привязки буфера
+    bool bindUniformBlock(const char* blockName, GLuint bindingPoint) const {
+        GLuint index = glGetUniformBlockIndex(program_, blockName);
+        if (index == GL_INVALID_INDEX) return false;
+        glUniformBlockBinding(program_, index, bindingPoint);
+        return true;
+    }
+
+private:
+    struct Uniform {
+        GLint location = -1;
+        GLenum type = 0;
+        GLint size = 0;
+        float value[16] = {};
+        bool uploaded = false;  // Значение по умолчанию в драйвере неизвестно, первая загрузка обязательна
+    };
+
+    static GLuint& currentProgram() {
+        static GLuint current = 0;
+        return current;
+    }
+
+    // Сравнение с последним загруженным значением; при отличии кэш обновляется
+    bool changed(Handle h, const float* value, size_t floats) {
+        if (h < 0) return false;
+        Uniform& u = uniforms_[h];
+        if (u.uploaded && std::memcmp(u.value, value, floats * sizeof(float)) == 0) {
+            glStats.uniformsSkipped++;
+            return false;
+        }
+        std::memcpy(u.value, value, floats * sizeof(float));
+        u.uploaded = true;
+        glStats.uniformUploads++;
+        return true;
+    }
+
+    GLuint program_ = 0;
+    std::vector<Uniform> uniforms_;
+    std::unordered_map<std::string, Handle> lookup_;
+};
+
+// Uniform-буфер с теневой копией на CPU: glBufferSubData вызывается только при изменении данных
+class UniformBuffer {
+public:
+    void create(GLsizeiptr size, GLuint bindingPoint) {
+        shadow_.assign(size_t(size), 0);
+        uploaded_ = false;
+        glGenBuffers(1, &buffer_);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer_);
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, buffer_);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // Данные больше буфера, заданного в create, отклоняются целиком: ни копии, ни загрузки
+    bool update(const void* data, size_t size) {
+        if (size > shadow_.size()) return false;
+        if (uploaded_ && std::memcmp(shadow_.data(), data, size) == 0) {
+            glStats.buffersSkipped++;
+            return true;
+        }
+        std::memcpy(shadow_.data(), data, size);
+        uploaded_ = true;
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer_);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, GLsizeiptr(size), data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glStats.bufferUploads++;
+        return true;
+    }
+
+    GLuint id() const { return buffer_; }
+
+private:
+    GLuint buffer_ = 0;
+    std::vector<unsigned char> shadow_;
+    bool uploaded_ = false;
+};
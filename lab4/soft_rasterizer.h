@@ -0,0 +1,663 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../common/cpu_math.h"
+#include "mesh_pipeline.h"
+
+// Программный растеризатор для машин без GPU: тот же формат вершин (позиция, цвет, нормаль),
+// те же матрицы model/view/projection и та же модель освещения Фонга, что и в шейдерах lab4.
+// Этапы: преобразование вершин, отсечение по ближней и дальней плоскостям, раскладка
+// треугольников по экранным плиткам и параллельная растеризация плиток с буфером глубины.
+
+// Параметры освещения — те же значения, что уходят в uniform-переменные шейдера
+struct PhongParams {
+    float lightPos[3];
+    float viewPos[3];
+    float specularPower;
+    float specularIntensity;
+};
+
+// Кадр в формате GL: строка 0 — нижняя, цвет RGB8, глубина в [0, 1]
+struct SoftFramebuffer {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> color;
+    std::vector<float> depth;
+
+    void resize(int w, int h) {
+        width = w;
+        height = h;
+        color.assign(size_t(w) * size_t(h) * 3, 0);
+        depth.assign(size_t(w) * size_t(h), 1.0f);
+    }
+
+    void clear(float r, float g, float b) {
+        const uint8_t rgb[3] = {toByte(r), toByte(g), toByte(b)};
+        for (size_t i = 0; i < color.size(); i += 3) std::copy(rgb, rgb + 3, &color[i]);
+        std::fill(depth.begin(), depth.end(), 1.0f);
+    }
+
+    // Запись в бинарный PPM (строки сверху вниз)
+    bool writePPM(const std::string& path) const {
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) return false;
+        std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+        for (int y = height - 1; y >= 0; --y) {
+            std::fwrite(&color[size_t(y) * size_t(width) * 3], 1, size_t(width) * 3, file);
+        }
+        return std::fclose(file) == 0;
+    }
+
+    static uint8_t toByte(float v) { return uint8_t(std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f)); }
+};
+
+// Сравнение двух кадров: число пикселей, у которых хотя бы один канал отличается больше чем на tolerance
+inline size_t countDifferentPixels(const SoftFramebuffer& a, const SoftFramebuffer& b, int tolerance, int* maxDifference) {
+    size_t different = 0;
+    int maxDiff = 0;
+    for (size_t i = 0; i < a.color.size(); i += 3) {
+        int diff = 0;
+        for (int c = 0; c < 3; ++c) diff = std::max(diff, std::abs(int(a.color[i + c]) - int(b.color[i + c])));
+        maxDiff = std::max(maxDiff, diff);
+        if (diff > tolerance) ++different;
+    }
+    if (maxDifference) *maxDifference = maxDiff;
+    return different;
+}
+
+// Постоянный набор потоков для параллельных циклов: вызывающий поток работает как поток 0
+class WorkerPool {
+public:
+    explicit WorkerPool(unsigned threads = 1) { resize(threads); }
+    ~WorkerPool() { stop(); }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    unsigned size() const { return unsigned(workers_.size()) + 1; }
+
+    // Новые потоки получают текущее поколение задач: иначе поток, стартовавший после прошлых
+    // parallelFor, принял бы уже завершенную задачу за новую. Значение берется здесь, а не в
+    // самом потоке — поток может проснуться уже после того, как следующий parallelFor выдал задачу.
+    void resize(unsigned threads) {
+        stop();
+        stopping_ = false;
+        const uint64_t generation = generation_;
+        for (unsigned id = 1; id < std::max(threads, 1u); ++id) {
+            workers_.emplace_back([this, id, generation] { workerLoop(id, generation); });
+        }
+    }
+
+    // fn(индекс задачи, номер потока) для индексов [0, count); задачи раздаются по одной
+    void parallelFor(size_t count, const std::function<void(size_t, unsigned)>& fn) {
+        if (workers_.empty() || count <= 1) {
+            for (size_t i = 0; i < count; ++i) fn(i, 0);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = &fn;
+            count_ = count;
+            next_ = 0;
+            active_ = unsigned(workers_.size());
+            ++generation_;
+        }
+        wake_.notify_all();
+        runJob(0);
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return active_ == 0; });
+        job_ = nullptr;
+    }
+
+private:
+    void workerLoop(unsigned id, uint64_t seen) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+            if (stopping_) return;
+            seen = generation_;
+            lock.unlock();
+            runJob(id);
+            lock.lock();
+            if (--active_ == 0) done_.notify_one();
+        }
+    }
+
+    void runJob(unsigned id) {
+        for (size_t i = next_.fetch_add(1); i < count_; i = next_.fetch_add(1)) (*job_)(i, id);
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (std::thread& worker : workers_) worker.join();
+        workers_.clear();
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_, done_;
+    const std::function<void(size_t, unsigned)>* job_ = nullptr;
+    std::atomic<size_t> next_{0};
+    size_t count_ = 0;
+    unsigned active_ = 0;
+    uint64_t generation_ = 0;
+    bool stopping_ = false;
+};
+
+// Вершина после вершинного этапа: клиповые координаты и атрибуты для фрагментного этапа
+struct ClipVertex {
+    float clip[4];
+    float attributes[9];  // Мировая позиция, нормаль, цвет (как FragPos, Normal, ourColor в шейдере)
+};
+
+// Треугольник, подготовленный к растеризации: функции ребер E = A*x + B*y + C
+// положительны внутри, атрибуты разделены на w для перспективно-корректной интерполяции
+struct SetupTriangle {
+    float edgeA[3], edgeB[3], edgeC[3];
+    bool topLeft[3];   // Правило верхнего-левого ребра: общие ребра закрашиваются ровно один раз
+    float invArea;
+    float depth[3];    // Глубина окна, линейна в экранных координатах
+    float invW[3];
+    float attributes[3][9];
+    int minX, minY, maxX, maxY;  // Пиксельный прямоугольник, включительно
+};
+
+// Отсечение по ближней (z >= -w) и дальней (z <= w) плоскостям, затем деление на w,
+// преобразование в окно и построение функций ребер. Грани обеих ориентаций рисуются,
+// как и в lab4 (GL_CULL_FACE выключен). Возвращает число полученных треугольников.
+inline int setupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, int width, int height, SetupTriangle* out) {
+    ClipVertex polygon[2][5];
+    int count = 3;
+    polygon[0][0] = v0;
+    polygon[0][1] = v1;
+    polygon[0][2] = v2;
+
+    int current = 0;
+    for (int plane = 0; plane < 2; ++plane) {
+        const float sign = plane == 0 ? 1.0f : -1.0f;  // Расстояние: w + z для ближней, w - z для дальней
+        const ClipVertex* in = polygon[current];
+        ClipVertex* result = polygon[current ^ 1];
+        int resultCount = 0;
+        for (int i = 0; i < count; ++i) {
+            const ClipVertex& a = in[i];
+            const ClipVertex& b = in[(i + 1) % count];
+            float da = a.clip[3] + sign * a.clip[2];
+            float db = b.clip[3] + sign * b.clip[2];
+            if (da >= 0.0f) result[resultCount++] = a;
+            if ((da >= 0.0f) != (db >= 0.0f)) {
+                float t = da / (da - db);
+                ClipVertex& v = result[resultCount++];
+                for (int k = 0; k < 4; ++k) v.clip[k] = a.clip[k] + (b.clip[k] - a.clip[k]) * t;
+                for (int k = 0; k < 9; ++k) v.attributes[k] = a.attributes[k] + (b.attributes[k] - a.attributes[k]) * t;
+            }
+        }
+        count = resultCount;
+        current ^= 1;
+        if (count < 3) return 0;
+    }
+
+    // Вершины многоугольника в координатах окна
+    float sx[5], sy[5], sz[5], invW[5];
+    const ClipVertex* poly = polygon[current];
+    for (int i = 0; i < count; ++i) {
+        invW[i] = 1.0f / poly[i].clip[3];
+        sx[i] = (poly[i].clip[0] * invW[i] * 0.5f + 0.5f) * float(width);
+        sy[i] = (poly[i].clip[1] * invW[i] * 0.5f + 0.5f) * float(height);
+        sz[i] = poly[i].clip[2] * invW[i] * 0.5f + 0.5f;
+    }
+
+    // Веер треугольников из отсеченного многоугольника
+    int produced = 0;
+    for (int f = 1; f + 1 < count; ++f) {
+        const int id[3] = {0, f, f + 1};
+        SetupTriangle& t = out[produced];
+
+        float area = (sx[id[1]] - sx[id[0]]) * (sy[id[2]] - sy[id[0]]) - (sx[id[2]] - sx[id[0]]) * (sy[id[1]] - sy[id[0]]);
+        if (area == 0.0f || !std::isfinite(area)) continue;
+        const float orientation = area > 0.0f ? 1.0f : -1.0f;
+
+        // Ребро i лежит напротив вершины i, E_i / area — барицентрическая координата вершины i
+        for (int i = 0; i < 3; ++i) {
+            int j = id[(i + 1) % 3], k = id[(i + 2) % 3];
+            t.edgeA[i] = (sy[j] - sy[k]) * orientation;
+            t.edgeB[i] = (sx[k] - sx[j]) * orientation;
+            t.edgeC[i] = (sx[j] * sy[k] - sx[k] * sy[j]) * orientation;
+            t.topLeft[i] = t.edgeA[i] > 0.0f || (t.edgeA[i] == 0.0f && t.edgeB[i] > 0.0f);
+        }
+        t.invArea = 1.0f / (area * orientation);
+
+        float minX = sx[id[0]], maxX = minX, minY = sy[id[0]], maxY = minY;
+        for (int i = 0; i < 3; ++i) {
+            const int v = id[i];
+            t.depth[i] = sz[v];
+            t.invW[i] = invW[v];
+            for (int k = 0; k < 9; ++k) t.attributes[i][k] = poly[v].attributes[k] * invW[v];
+            minX = std::min(minX, sx[v]);
+            maxX = std::max(maxX, sx[v]);
+            minY = std::min(minY, sy[v]);
+            maxY = std::max(maxY, sy[v]);
+        }
+
+        // Центры пикселей в (x + 0.5, y + 0.5)
+        t.minX = std::max(int(std::ceil(minX - 0.5f)), 0);
+        t.minY = std::max(int(std::ceil(minY - 0.5f)), 0);
+        t.maxX = std::min(int(std::floor(maxX - 0.5f)), width - 1);
+        t.maxY = std::min(int(std::floor(maxY - 0.5f)), height - 1);
+        if (t.minX > t.maxX || t.minY > t.maxY) continue;
+        ++produced;
+    }
+    return produced;
+}
+
+// Перенос фрагментного шейдера lab4: фоновая, диффузная и зеркальная составляющие
+inline void shadePhong(const float* attributes, const PhongParams& phong, uint8_t* out) {
+    const float* fragPos = attributes;
+    const float* normal = attributes + 3;
+    const float* color = attributes + 6;
+
+    auto normalize = [](float* v) {
+        float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        if (length > 0.0f) { v[0] /= length; v[1] /= length; v[2] /= length; }
+    };
+    auto dot = [](const float* a, const float* b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; };
+
+    float norm[3] = {normal[0], normal[1], normal[2]};
+    normalize(norm);
+    float lightDir[3] = {phong.lightPos[0] - fragPos[0], phong.lightPos[1] - fragPos[1], phong.lightPos[2] - fragPos[2]};
+    normalize(lightDir);
+    float diff = std::max(dot(norm, lightDir), 0.0f);
+
+    float viewDir[3] = {phong.viewPos[0] - fragPos[0], phong.viewPos[1] - fragPos[1], phong.viewPos[2] - fragPos[2]};
+    normalize(viewDir);
+    // reflect(-L, N) = -L + 2 * dot(N, L) * N
+    float nl = 2.0f * dot(norm, lightDir);
+    float reflectDir[3] = {-lightDir[0] + nl * norm[0], -lightDir[1] + nl * norm[1], -lightDir[2] + nl * norm[2]};
+    float spec = std::pow(std::max(dot(viewDir, reflectDir), 0.0f), phong.specularPower) * phong.specularIntensity;
+
+    for (int c = 0; c < 3; ++c) {
+        out[c] = SoftFramebuffer::toByte(0.1f * color[c] + diff * color[c] + spec);
+    }
+}
+
+// Закраска одного покрытого пикселя: тест глубины GL_LESS, интерполяция атрибутов, освещение
+inline void shadeFragment(const SetupTriangle& t, const float* lambda, size_t pixel, const PhongParams& phong, SoftFramebuffer& target) {
+    // Глубина от вершины 0: сумма lambda отличается от 1 на ошибку округления функций ребер,
+    // и в форме sum(lambda_i * z_i) эта ошибка умножалась бы на саму глубину (~1), а не на ее перепад
+    float z = t.depth[0] + lambda[1] * (t.depth[1] - t.depth[0]) + lambda[2] * (t.depth[2] - t.depth[0]);
+    if (!(z < target.depth[pixel])) return;
+    target.depth[pixel] = z;
+
+    float w = 1.0f / (lambda[0] * t.invW[0] + lambda[1] * t.invW[1] + lambda[2] * t.invW[2]);
+    float attributes[9];
+    for (int k = 0; k < 9; ++k) {
+        attributes[k] = (lambda[0] * t.attributes[0][k] + lambda[1] * t.attributes[1][k] + lambda[2] * t.attributes[2][k]) * w;
+    }
+    shadePhong(attributes, phong, &target.color[pixel * 3]);
+}
+
+// Растеризация треугольника внутри прямоугольника [x0, x1] x [y0, y1]: функции ребер
+// считаются сразу для четырех соседних пикселей строки
+inline void rasterizeTriangle(const SetupTriangle& t, int x0, int y0, int x1, int y1, const PhongParams& phong, SoftFramebuffer& target) {
+    x0 = std::max(x0, t.minX);
+    y0 = std::max(y0, t.minY);
+    x1 = std::min(x1, t.maxX);
+    y1 = std::min(y1, t.maxY);
+    if (x0 > x1 || y0 > y1) return;
+
+#if defined(CPU_MATH_USE_SSE)
+    const __m128 laneOffset = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 allLanes = _mm_cmpeq_ps(zero, zero);
+    const __m128 invArea = _mm_set1_ps(t.invArea);
+    __m128 edgeA[3], topLeft[3];
+    for (int i = 0; i < 3; ++i) {
+        edgeA[i] = _mm_set1_ps(t.edgeA[i]);
+        topLeft[i] = t.topLeft[i] ? allLanes : zero;
+    }
+    for (int y = y0; y <= y1; ++y) {
+        const float py = float(y) + 0.5f;
+        __m128 rowBase[3];
+        for (int i = 0; i < 3; ++i) rowBase[i] = _mm_set1_ps(t.edgeB[i] * py + t.edgeC[i]);
+        for (int x = x0; x <= x1; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps(float(x)), laneOffset);
+            __m128 inside = allLanes;
+            __m128 edge[3];
+            for (int i = 0; i < 3; ++i) {
+                edge[i] = _mm_add_ps(_mm_mul_ps(edgeA[i], px), rowBase[i]);
+                __m128 covered = _mm_or_ps(_mm_cmpgt_ps(edge[i], zero), _mm_and_ps(_mm_cmpeq_ps(edge[i], zero), topLeft[i]));
+                inside = _mm_and_ps(inside, covered);
+            }
+            int mask = _mm_movemask_ps(inside);
+            if (x1 - x < 3) mask &= (1 << (x1 - x + 1)) - 1;  // Хвост строки за пределами прямоугольника
+            if (mask == 0) continue;
+
+            alignas(16) float lambda[3][4];
+            for (int i = 0; i < 3; ++i) _mm_store_ps(lambda[i], _mm_mul_ps(edge[i], invArea));
+            for (int lane = 0; lane < 4; ++lane) {
+                if (!(mask & (1 << lane))) continue;
+                const float l[3] = {lambda[0][lane], lambda[1][lane], lambda[2][lane]};
+                shadeFragment(t, l, size_t(y) * size_t(target.width) + size_t(x + lane), phong, target);
+            }
+        }
+    }
+#else
+    for (int y = y0; y <= y1; ++y) {
+        const float py = float(y) + 0.5f;
+        float rowBase[3];
+        for (int i = 0; i < 3; ++i) rowBase[i] = t.edgeB[i] * py + t.edgeC[i];
+        for (int x = x0; x <= x1; ++x) {
+            const float px = float(x) + 0.5f;
+            float lambda[3];
+            bool inside = true;
+            for (int i = 0; i < 3; ++i) {
+                float edge = t.edgeA[i] * px + rowBase[i];
+                inside = inside && (edge > 0.0f || (edge == 0.0f && t.topLeft[i]));
+                lambda[i] = edge * t.invArea;
+            }
+            if (inside) shadeFragment(t, lambda, size_t(y) * size_t(target.width) + size_t(x), phong, target);
+        }
+    }
+#endif
+}
+
+// Вершинный этап: клиповые координаты и атрибуты фрагментного шейдера
+inline void transformVertex(const RawVertex& v, const Mat4& model, const Mat4& viewProjection, const Mat3& normalMatrix, ClipVertex& out) {
+    Vec4 world = mat4Transform(model, {v.position[0], v.position[1], v.position[2], 1.0f});
+    Vec4 clip = mat4Transform(viewProjection, world);
+    out.clip[0] = clip.x;
+    out.clip[1] = clip.y;
+    out.clip[2] = clip.z;
+    out.clip[3] = clip.w;
+    out.attributes[0] = world.x;
+    out.attributes[1] = world.y;
+    out.attributes[2] = world.z;
+    for (int r = 0; r < 3; ++r) {
+        out.attributes[3 + r] = normalMatrix.m[r] * v.normal[0] + normalMatrix.m[3 + r] * v.normal[1] + normalMatrix.m[6 + r] * v.normal[2];
+        out.attributes[6 + r] = v.color[r];
+    }
+}
+
+// Независимый эталон для сверки: свой вершинный этап, отсечение, проверка покрытия и освещение
+// по формулам шейдера lab4, все в double. С растеризатором общие только входные данные (сетка,
+// матрицы, PhongParams), формат кадра и соглашения GL: центры пикселей, тест глубины GL_LESS и
+// принадлежность общего ребра одному треугольнику. Поэтому сверка проверяет и transformVertex,
+// setupTriangle и shadeFragment, а не только раскладку по плиткам и потокам.
+inline void renderReference(const Mesh& mesh, const Mat4& model, const Mat4& view, const Mat4& projection,
+                            const PhongParams& phong, SoftFramebuffer& target) {
+    struct RefVertex {
+        double clip[4];
+        double world[3];
+        double normal[3];
+        double color[3];
+    };
+    auto transform = [](const Mat4& m, const double* v, double* out) {
+        for (int r = 0; r < 4; ++r) out[r] = m.m[r] * v[0] + m.m[4 + r] * v[1] + m.m[8 + r] * v[2] + m.m[12 + r] * v[3];
+    };
+
+    // Матрица нормалей: алгебраические дополнения блока 3x3 модели, деленные на определитель
+    // (это транспонированная обратная матрица)
+    double a[3][3], normalMatrix[3][3];
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) a[r][c] = model.m[c * 4 + r];
+    }
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            const int r1 = (r + 1) % 3, r2 = (r + 2) % 3, c1 = (c + 1) % 3, c2 = (c + 2) % 3;
+            normalMatrix[r][c] = a[r1][c1] * a[r2][c2] - a[r1][c2] * a[r2][c1];
+        }
+    }
+    const double det = a[0][0] * normalMatrix[0][0] + a[0][1] * normalMatrix[0][1] + a[0][2] * normalMatrix[0][2];
+    for (auto& row : normalMatrix) {
+        for (double& v : row) v /= det;
+    }
+
+    std::vector<RefVertex> vertices(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+        const RawVertex& in = mesh.vertices[i];
+        RefVertex& out = vertices[i];
+        const double position[4] = {in.position[0], in.position[1], in.position[2], 1.0};
+        double world[4], eye[4];
+        transform(model, position, world);
+        transform(view, world, eye);
+        transform(projection, eye, out.clip);
+        for (int k = 0; k < 3; ++k) {
+            out.world[k] = world[k];
+            out.normal[k] = normalMatrix[k][0] * in.normal[0] + normalMatrix[k][1] * in.normal[1] + normalMatrix[k][2] * in.normal[2];
+            out.color[k] = in.color[k];
+        }
+    }
+
+    auto normalize = [](double* v) {
+        const double length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        if (length > 0.0) { v[0] /= length; v[1] /= length; v[2] /= length; }
+    };
+    auto dot = [](const double* x, const double* y) { return x[0] * y[0] + x[1] * y[1] + x[2] * y[2]; };
+    auto lerp = [](const RefVertex& p, const RefVertex& q, double t) {
+        RefVertex v;
+        for (int k = 0; k < 4; ++k) v.clip[k] = p.clip[k] + (q.clip[k] - p.clip[k]) * t;
+        for (int k = 0; k < 3; ++k) {
+            v.world[k] = p.world[k] + (q.world[k] - p.world[k]) * t;
+            v.normal[k] = p.normal[k] + (q.normal[k] - p.normal[k]) * t;
+            v.color[k] = p.color[k] + (q.color[k] - p.color[k]) * t;
+        }
+        return v;
+    };
+
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        // Отсечение ближней плоскостью z >= -w (Сазерленд — Ходжмен). Дальняя плоскость не нужна:
+        // фрагменты за ней дают глубину больше 1 и не проходят тест с очищенным буфером
+        std::vector<RefVertex> polygon = {vertices[mesh.indices[i]], vertices[mesh.indices[i + 1]], vertices[mesh.indices[i + 2]]};
+        std::vector<RefVertex> clipped;
+        for (size_t v = 0; v < polygon.size(); ++v) {
+            const RefVertex& p = polygon[v];
+            const RefVertex& q = polygon[(v + 1) % polygon.size()];
+            const double dp = p.clip[3] + p.clip[2], dq = q.clip[3] + q.clip[2];
+            if (dp >= 0.0) clipped.push_back(p);
+            if ((dp >= 0.0) != (dq >= 0.0)) clipped.push_back(lerp(p, q, dp / (dp - dq)));
+        }
+
+        for (size_t f = 1; f + 1 < clipped.size(); ++f) {
+            const RefVertex* tri[3] = {&clipped[0], &clipped[f], &clipped[f + 1]};
+            double sx[3], sy[3], sz[3], invW[3];
+            for (int v = 0; v < 3; ++v) {
+                invW[v] = 1.0 / tri[v]->clip[3];
+                sx[v] = (tri[v]->clip[0] * invW[v] * 0.5 + 0.5) * target.width;
+                sy[v] = (tri[v]->clip[1] * invW[v] * 0.5 + 0.5) * target.height;
+                sz[v] = tri[v]->clip[2] * invW[v] * 0.5 + 0.5;
+            }
+            double area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sx[2] - sx[0]) * (sy[1] - sy[0]);
+            if (area == 0.0 || !std::isfinite(area)) continue;
+            if (area < 0.0) {  // Обход против часовой стрелки, чтобы "внутри" всегда было положительным
+                std::swap(tri[1], tri[2]);
+                std::swap(sx[1], sx[2]);
+                std::swap(sy[1], sy[2]);
+                std::swap(sz[1], sz[2]);
+                std::swap(invW[1], invW[2]);
+                area = -area;
+            }
+
+            // Ребро от вершины e+1 к e+2; пиксель ровно на ребре принадлежит треугольнику, если ребро
+            // идет вниз или горизонтально вправо — соседний треугольник проходит его в обратную сторону
+            bool ownsEdge[3];
+            for (int e = 0; e < 3; ++e) {
+                const double dx = sx[(e + 2) % 3] - sx[(e + 1) % 3], dy = sy[(e + 2) % 3] - sy[(e + 1) % 3];
+                ownsEdge[e] = dy < 0.0 || (dy == 0.0 && dx > 0.0);
+            }
+
+            const int x0 = std::max(0, int(std::floor(std::min({sx[0], sx[1], sx[2]})))),
+                      x1 = std::min(target.width - 1, int(std::ceil(std::max({sx[0], sx[1], sx[2]})))),
+                      y0 = std::max(0, int(std::floor(std::min({sy[0], sy[1], sy[2]})))),
+                      y1 = std::min(target.height - 1, int(std::ceil(std::max({sy[0], sy[1], sy[2]}))));
+            for (int y = y0; y <= y1; ++y) {
+                for (int x = x0; x <= x1; ++x) {
+                    const double px = x + 0.5, py = y + 0.5;
+                    double weight[3];
+                    bool inside = true;
+                    for (int e = 0; e < 3; ++e) {
+                        const int p = (e + 1) % 3, q = (e + 2) % 3;
+                        const double edge = (sx[q] - sx[p]) * (py - sy[p]) - (sy[q] - sy[p]) * (px - sx[p]);
+                        inside = inside && (edge > 0.0 || (edge == 0.0 && ownsEdge[e]));
+                        weight[e] = edge / area;
+                    }
+                    if (!inside) continue;
+
+                    const size_t pixel = size_t(y) * size_t(target.width) + size_t(x);
+                    const double z = weight[0] * sz[0] + weight[1] * sz[1] + weight[2] * sz[2];
+                    if (!(z < target.depth[pixel])) continue;
+                    target.depth[pixel] = float(z);
+
+                    // Перспективно-корректная интерполяция: атрибут / w линеен на экране
+                    double perspective[3], sum = 0.0;
+                    for (int v = 0; v < 3; ++v) sum += perspective[v] = weight[v] * invW[v];
+                    double fragPos[3] = {}, normal[3] = {}, color[3] = {};
+                    for (int v = 0; v < 3; ++v) {
+                        for (int k = 0; k < 3; ++k) {
+                            fragPos[k] += perspective[v] / sum * tri[v]->world[k];
+                            normal[k] += perspective[v] / sum * tri[v]->normal[k];
+                            color[k] += perspective[v] / sum * tri[v]->color[k];
+                        }
+                    }
+
+                    // Освещение по Фонгу, как во фрагментном шейдере
+                    normalize(normal);
+                    double lightDir[3], viewDir[3], reflectDir[3];
+                    for (int k = 0; k < 3; ++k) {
+                        lightDir[k] = phong.lightPos[k] - fragPos[k];
+                        viewDir[k] = phong.viewPos[k] - fragPos[k];
+                    }
+                    normalize(lightDir);
+                    normalize(viewDir);
+                    const double diff = std::max(dot(normal, lightDir), 0.0);
+                    for (int k = 0; k < 3; ++k) reflectDir[k] = 2.0 * dot(normal, lightDir) * normal[k] - lightDir[k];
+                    const double spec = std::pow(std::max(dot(viewDir, reflectDir), 0.0), double(phong.specularPower)) * phong.specularIntensity;
+                    for (int k = 0; k < 3; ++k) {
+                        const double value = std::clamp(0.1 * color[k] + diff * color[k] + spec, 0.0, 1.0);
+                        target.color[pixel * 3 + k] = uint8_t(std::lround(value * 255.0));
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Многопоточный растеризатор с раскладкой по плиткам TILE_SIZE x TILE_SIZE.
+// Треугольники делятся на непрерывные порции; каждая порция готовит свои треугольники и
+// свои списки плиток, а плитка обходит порции по порядку — порядок отрисовки как у GPU.
+class SoftRasterizer {
+public:
+    static constexpr int TILE_SIZE = 32;
+
+    struct Stats {
+        size_t trianglesIn = 0;
+        size_t trianglesSetup = 0;
+        size_t binEntries = 0;
+        double vertexMs = 0.0;
+        double setupMs = 0.0;
+        double rasterMs = 0.0;
+    };
+
+    explicit SoftRasterizer(unsigned threads = 1) : pool_(threads) {}
+
+    void setThreads(unsigned threads) { pool_.resize(threads); }
+    unsigned threads() const { return pool_.size(); }
+    const Stats& stats() const { return stats_; }
+
+    void draw(const Mesh& mesh, const Mat4& model, const Mat4& view, const Mat4& projection,
+              const PhongParams& phong, SoftFramebuffer& target) {
+        using Clock = std::chrono::steady_clock;
+        stats_ = Stats();
+        stats_.trianglesIn = mesh.indices.size() / 3;
+
+        const int tilesX = (target.width + TILE_SIZE - 1) / TILE_SIZE;
+        const int tilesY = (target.height + TILE_SIZE - 1) / TILE_SIZE;
+        const size_t tileCount = size_t(tilesX) * size_t(tilesY);
+
+        // 1. Вершинный этап
+        auto start = Clock::now();
+        const Mat4 viewProjection = mat4Multiply(projection, view);
+        const Mat3 normalMatrix = mat4NormalMatrix(model);
+        transformed_.resize(mesh.vertices.size());
+        const size_t vertexChunk = 4096;
+        pool_.parallelFor((mesh.vertices.size() + vertexChunk - 1) / vertexChunk, [&](size_t chunk, unsigned) {
+            size_t end = std::min(mesh.vertices.size(), (chunk + 1) * vertexChunk);
+            for (size_t i = chunk * vertexChunk; i < end; ++i) transformVertex(mesh.vertices[i], model, viewProjection, normalMatrix, transformed_[i]);
+        });
+        auto vertexEnd = Clock::now();
+
+        // 2. Отсечение, подготовка треугольников и раскладка по плиткам
+        const size_t triangleChunk = 2048;
+        const size_t chunkCount = (stats_.trianglesIn + triangleChunk - 1) / triangleChunk;
+        if (chunks_.size() < chunkCount) chunks_.resize(chunkCount);
+        pool_.parallelFor(chunkCount, [&](size_t c, unsigned) {
+            Chunk& chunk = chunks_[c];
+            chunk.triangles.clear();
+            chunk.bins.resize(tileCount);
+            for (std::vector<uint32_t>& bin : chunk.bins) bin.clear();
+
+            size_t end = std::min(stats_.trianglesIn, (c + 1) * triangleChunk);
+            SetupTriangle setup[3];
+            for (size_t tri = c * triangleChunk; tri < end; ++tri) {
+                const uint32_t* index = &mesh.indices[tri * 3];
+                int produced = setupTriangle(transformed_[index[0]], transformed_[index[1]], transformed_[index[2]],
+                                             target.width, target.height, setup);
+                for (int s = 0; s < produced; ++s) {
+                    const uint32_t id = uint32_t(chunk.triangles.size());
+                    chunk.triangles.push_back(setup[s]);
+                    for (int ty = setup[s].minY / TILE_SIZE; ty <= setup[s].maxY / TILE_SIZE; ++ty) {
+                        for (int tx = setup[s].minX / TILE_SIZE; tx <= setup[s].maxX / TILE_SIZE; ++tx) {
+                            chunk.bins[size_t(ty) * size_t(tilesX) + size_t(tx)].push_back(id);
+                        }
+                    }
+                }
+            }
+        });
+        for (size_t c = 0; c < chunkCount; ++c) {
+            stats_.trianglesSetup += chunks_[c].triangles.size();
+            for (const std::vector<uint32_t>& bin : chunks_[c].bins) stats_.binEntries += bin.size();
+        }
+        auto setupEnd = Clock::now();
+
+        // 3. Растеризация: каждая плитка пишет только в свои пиксели, блокировки не нужны
+        pool_.parallelFor(tileCount, [&](size_t tile, unsigned) {
+            const int x0 = int(tile % size_t(tilesX)) * TILE_SIZE;
+            const int y0 = int(tile / size_t(tilesX)) * TILE_SIZE;
+            const int x1 = std::min(x0 + TILE_SIZE, target.width) - 1;
+            const int y1 = std::min(y0 + TILE_SIZE, target.height) - 1;
+            for (size_t c = 0; c < chunkCount; ++c) {
+                for (uint32_t id : chunks_[c].bins[tile]) rasterizeTriangle(chunks_[c].triangles[id], x0, y0, x1, y1, phong, target);
+            }
+        });
+        auto rasterEnd = Clock::now();
+
+        stats_.vertexMs = std::chrono::duration<double, std::milli>(vertexEnd - start).count();
+        stats_.setupMs = std::chrono::duration<double, std::milli>(setupEnd - vertexEnd).count();
+        stats_.rasterMs = std::chrono::duration<double, std::milli>(rasterEnd - setupEnd).count();
+    }
+
+private:
+    struct Chunk {
+        std::vector<SetupTriangle> triangles;
+        std::vector<std::vector<uint32_t>> bins;  // Индексы треугольников порции для каждой плитки
+    };
+
+    WorkerPool pool_;
+    std::vector<ClipVertex> transformed_;
+    std::vector<Chunk> chunks_;
+    Stats stats_;
+};
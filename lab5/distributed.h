@@ -0,0 +1,453 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "tracer.h"
+
+// Распределенный рендеринг по плиткам: координатор запускает N рабочих процессов (fork +
+// socketpair, только localhost/POSIX), один раз передает им сериализованную сцену и раздает
+// плитки. Рабочие возвращают плитки в RGB8, сжатом RLE; медленные плитки переназначаются
+// свободным рабочим, засчитывается первый пришедший результат.
+//
+// Протокол: сообщение = заголовок {тип, длина} + данные длиной length байт.
+//   SCENE       — сцена (сферы, плоскости, свет, viewPos), отправляется при изменении
+//   TILE_JOB    — {кадр, плитка, x, y, ширина, высота, ширина кадра, высота кадра}
+//   TILE_RESULT — {кадр, плитка, время трассировки в мкс, кодировка, длина} + пиксели
+//   SHUTDOWN    — завершение рабочего процесса
+
+enum MessageType : uint32_t {
+    MSG_SCENE = 1,
+    MSG_TILE_JOB = 2,
+    MSG_TILE_RESULT = 3,
+    MSG_SHUTDOWN = 4,
+};
+
+struct MessageHeader {
+    uint32_t type;
+    uint32_t length;
+};
+
+struct TileJob {
+    uint32_t frame;
+    uint32_t tile;
+    int32_t x, y, width, height;
+    int32_t frameWidth, frameHeight;
+};
+
+enum TileEncoding : uint32_t {
+    TILE_RAW = 0,  // RGB8 без сжатия
+    TILE_RLE = 1,  // Пары {длина серии 1..255, RGB}
+};
+
+struct TileResultHeader {
+    uint32_t frame;
+    uint32_t tile;
+    uint32_t traceMicroseconds;
+    uint32_t encoding;
+    uint32_t length;
+};
+
+// Запись и чтение ровно size байт (сокет может вернуть данные частями)
+inline bool writeAll(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = ::write(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= size_t(n);
+    }
+    return true;
+}
+
+inline bool readAll(int fd, void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = ::read(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= size_t(n);
+    }
+    return true;
+}
+
+inline bool sendMessage(int fd, uint32_t type, const void* data, size_t size) {
+    MessageHeader header = {type, uint32_t(size)};
+    return writeAll(fd, &header, sizeof(header)) && (size == 0 || writeAll(fd, data, size));
+}
+
+inline bool receiveMessage(int fd, MessageHeader& header, std::vector<uint8_t>& payload) {
+    if (!readAll(fd, &header, sizeof(header))) return false;
+    payload.resize(header.length);
+    return header.length == 0 || readAll(fd, payload.data(), payload.size());
+}
+
+// Сериализация сцены в плоский массив float: счетчики, сферы (7), плоскости (9), свет (6), viewPos (3)
+inline std::vector<uint8_t> serializeScene(const Scene& scene) {
+    std::vector<float> data;
+    data.push_back(float(scene.spheres.size()));
+    data.push_back(float(scene.planes.size()));
+    auto push = [&](const glm::vec3& v) { data.insert(data.end(), {v.x, v.y, v.z}); };
+    for (const Sphere& sphere : scene.spheres) {
+        push(sphere.center);
+        data.push_back(sphere.radius);
+        push(sphere.color);
+    }
+    for (const Plane& plane : scene.planes) {
+        push(plane.point);
+        push(plane.normal);
+        push(plane.color);
+    }
+    push(scene.light.position);
+    push(scene.light.color);
+    push(scene.viewPos);
+
+    std::vector<uint8_t> bytes(data.size() * sizeof(float));
+    std::memcpy(bytes.data(), data.data(), bytes.size());
+    return bytes;
+}
+
+inline bool deserializeScene(const std::vector<uint8_t>& bytes, Scene& scene) {
+    std::vector<float> data(bytes.size() / sizeof(float));
+    std::memcpy(data.data(), bytes.data(), data.size() * sizeof(float));
+    size_t at = 0;
+    auto next = [&]() { return at < data.size() ? data[at++] : 0.0f; };
+    auto vec = [&]() { float x = next(), y = next(), z = next(); return glm::vec3(x, y, z); };
+
+    if (data.size() < 2) return false;
+    size_t sphereCount = size_t(next());
+    size_t planeCount = size_t(next());
+    if (data.size() != 2 + sphereCount * 7 + planeCount * 9 + 9) return false;
+
+    scene.spheres.resize(sphereCount);
+    for (Sphere& sphere : scene.spheres) {
+        sphere.center = vec();
+        sphere.radius = next();
+        sphere.color = vec();
+    }
+    scene.planes.resize(planeCount);
+    for (Plane& plane : scene.planes) {
+        plane.point = vec();
+        plane.normal = vec();
+        plane.color = vec();
+    }
+    scene.light.position = vec();
+    scene.light.color = vec();
+    scene.viewPos = vec();
+    return true;
+}
+
+// RLE по пикселям: фон и плоскость дают длинные серии одинаковых цветов
+inline void encodeRLE(const std::vector<uint8_t>& rgb, std::vector<uint8_t>& out) {
+    out.clear();
+    const size_t pixels = rgb.size() / 3;
+    for (size_t i = 0; i < pixels;) {
+        size_t run = 1;
+        while (i + run < pixels && run < 255 && std::memcmp(&rgb[i * 3], &rgb[(i + run) * 3], 3) == 0) ++run;
+        out.push_back(uint8_t(run));
+        out.insert(out.end(), &rgb[i * 3], &rgb[i * 3] + 3);
+        i += run;
+    }
+}
+
+inline bool decodeRLE(const uint8_t* data, size_t size, std::vector<uint8_t>& rgb, size_t pixels) {
+    rgb.clear();
+    rgb.reserve(pixels * 3);
+    for (size_t i = 0; i + 4 <= size; i += 4) {
+        for (uint8_t r = 0; r < data[i]; ++r) rgb.insert(rgb.end(), data + i + 1, data + i + 4);
+    }
+    return rgb.size() == pixels * 3;
+}
+
+// Цикл рабочего процесса: сцена, затем плитки до SHUTDOWN или закрытия сокета.
+// delayMs — искусственная задержка на плитку (для проверки переназначения медленных плиток)
+inline int runTileWorker(int fd, int delayMs = 0) {
+    Scene scene;
+    bool haveScene = false;
+    MessageHeader header;
+    std::vector<uint8_t> payload, rgb, encoded, message;
+    while (receiveMessage(fd, header, payload)) {
+        if (header.type == MSG_SHUTDOWN) break;
+        if (header.type == MSG_SCENE) {
+            haveScene = deserializeScene(payload, scene);
+            continue;
+        }
+        if (header.type != MSG_TILE_JOB || !haveScene || payload.size() != sizeof(TileJob)) continue;
+
+        TileJob job;
+        std::memcpy(&job, payload.data(), sizeof(job));
+        auto start = std::chrono::steady_clock::now();
+        traceTile(scene, job.frameWidth, job.frameHeight, job.x, job.y, job.width, job.height, rgb);
+        if (delayMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+        encodeRLE(rgb, encoded);
+        const bool useRLE = encoded.size() < rgb.size();
+        const std::vector<uint8_t>& pixels = useRLE ? encoded : rgb;
+        TileResultHeader result = {job.frame, job.tile, uint32_t(micros), useRLE ? TILE_RLE : TILE_RAW, uint32_t(pixels.size())};
+        message.resize(sizeof(result) + pixels.size());
+        std::memcpy(message.data(), &result, sizeof(result));
+        std::memcpy(message.data() + sizeof(result), pixels.data(), pixels.size());
+        if (!sendMessage(fd, MSG_TILE_RESULT, message.data(), message.size())) break;
+    }
+    ::close(fd);
+    return 0;
+}
+
+// Координатор: держит рабочие процессы, раздает плитки и собирает кадр в RGB8
+class RenderCoordinator {
+public:
+    static constexpr int MAX_WORKERS = 64;  // Владельцы плитки хранятся битовой маской
+
+    struct FrameStats {
+        double frameMs = 0.0;
+        double traceMs = 0.0;         // Сумма времени трассировки, присланного рабочими
+        size_t tiles = 0;
+        size_t messagesSent = 0;
+        size_t bytesSent = 0;
+        size_t bytesReceived = 0;
+        size_t rawPixelBytes = 0;     // Размер тех же плиток без сжатия
+        size_t reassignedTiles = 0;   // Плитки, выданные повторно из-за медленного рабочего
+        size_t discardedResults = 0;  // Опоздавшие дубликаты
+        size_t sceneUploads = 0;
+    };
+
+    RenderCoordinator() = default;
+    RenderCoordinator(const RenderCoordinator&) = delete;
+    RenderCoordinator& operator=(const RenderCoordinator&) = delete;
+    ~RenderCoordinator() { stop(); }
+
+    // Запуск рабочих процессов; вызывать до создания окна и контекста GL.
+    // slowWorkerDelayMs задерживает каждую плитку рабочего 0 (имитация перегруженной машины)
+    bool start(int workerCount, int slowWorkerDelayMs = 0) {
+        if (workerCount < 1 || workerCount > MAX_WORKERS) return false;
+        std::signal(SIGPIPE, SIG_IGN);  // Обрыв соединения обрабатывается по коду возврата write
+        for (int i = 0; i < workerCount; ++i) {
+            int fds[2];
+            if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return false;
+            pid_t pid = ::fork();
+            if (pid < 0) return false;
+            if (pid == 0) {
+                // Рабочий процесс: закрываем чужие сокеты и обслуживаем свой
+                ::close(fds[0]);
+                for (const Worker& other : workers_) ::close(other.fd);
+                ::_exit(runTileWorker(fds[1], i == 0 ? slowWorkerDelayMs : 0));
+            }
+            ::close(fds[1]);
+            workers_.push_back({fds[0], pid, true, 0});
+        }
+        sceneBytes_.clear();
+        return true;
+    }
+
+    void stop() {
+        for (Worker& worker : workers_) {
+            if (worker.alive) sendMessage(worker.fd, MSG_SHUTDOWN, nullptr, 0);
+            ::close(worker.fd);
+            ::waitpid(worker.pid, nullptr, 0);
+        }
+        workers_.clear();
+    }
+
+    int workerCount() const { return int(workers_.size()); }
+    const FrameStats& stats() const { return stats_; }
+
+    // Рендер кадра: rgb получает width * height * 3 байт (строка 0 — нижняя)
+    bool renderFrame(const Scene& scene, int width, int height, int tileSize, std::vector<uint8_t>& rgb) {
+        using Clock = std::chrono::steady_clock;
+        const auto frameStart = Clock::now();
+        stats_ = FrameStats();
+        ++frame_;
+        rgb.assign(size_t(width) * size_t(height) * 3, 0);
+
+        // Сцена отправляется только если изменилась с прошлого кадра
+        std::vector<uint8_t> sceneBytes = serializeScene(scene);
+        if (sceneBytes != sceneBytes_) {
+            sceneBytes_ = sceneBytes;
+            for (Worker& worker : workers_) {
+                if (worker.alive && !send(worker, MSG_SCENE, sceneBytes_.data(), sceneBytes_.size())) worker.alive = false;
+            }
+            stats_.sceneUploads++;
+        }
+
+        // Плитки кадра
+        tiles_.clear();
+        for (int y = 0; y < height; y += tileSize) {
+            for (int x = 0; x < width; x += tileSize) {
+                Tile tile;
+                tile.job = {frame_, uint32_t(tiles_.size()), x, y, std::min(tileSize, width - x), std::min(tileSize, height - y), width, height};
+                tiles_.push_back(tile);
+            }
+        }
+        stats_.tiles = tiles_.size();
+        size_t nextTile = 0, doneTiles = 0;
+        double averageTileMs = 0.0;
+        retry_.clear();
+
+        MessageHeader header;
+        std::vector<uint8_t> payload, decoded;
+        while (doneTiles < tiles_.size()) {
+            // Выдача работы: до двух плиток на рабочего, чтобы он не простаивал, пока ждет следующую
+            bool anyAlive = false;
+            for (size_t w = 0; w < workers_.size(); ++w) {
+                Worker& worker = workers_[w];
+                if (!worker.alive) continue;
+                anyAlive = true;
+                while (worker.inFlight < 2) {
+                    int tile = -1;
+                    while (!retry_.empty() && tiles_[retry_.back()].done) retry_.pop_back();
+                    if (!retry_.empty()) {
+                        tile = int(retry_.back());
+                        retry_.pop_back();
+                    } else if (nextTile < tiles_.size()) {
+                        tile = int(nextTile++);
+                    } else {
+                        tile = pickSlowTile(w, averageTileMs, Clock::now());
+                        if (tile >= 0) stats_.reassignedTiles++;
+                    }
+                    if (tile < 0) break;
+                    assign(w, size_t(tile), Clock::now());
+                }
+            }
+            if (!anyAlive) return false;
+
+            // Ожидание результатов; короткий таймаут, чтобы вовремя заметить медленные плитки
+            std::vector<pollfd> fds;
+            std::vector<size_t> owners;
+            for (size_t w = 0; w < workers_.size(); ++w) {
+                if (workers_[w].alive) {
+                    fds.push_back({workers_[w].fd, POLLIN, 0});
+                    owners.push_back(w);
+                }
+            }
+            if (::poll(fds.data(), nfds_t(fds.size()), 5) < 0 && errno != EINTR) return false;
+
+            for (size_t i = 0; i < fds.size(); ++i) {
+                if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+                Worker& worker = workers_[owners[i]];
+                if (!receiveMessage(worker.fd, header, payload) || header.type != MSG_TILE_RESULT || payload.size() < sizeof(TileResultHeader)) {
+                    // Рабочий упал: его незавершенные плитки возвращаются в раздачу
+                    dropWorker(owners[i]);
+                    continue;
+                }
+                stats_.bytesReceived += sizeof(header) + payload.size();
+                worker.inFlight--;
+
+                TileResultHeader result;
+                std::memcpy(&result, payload.data(), sizeof(result));
+                if (result.frame != frame_ || result.tile >= tiles_.size()) { stats_.discardedResults++; continue; }
+                Tile& tile = tiles_[result.tile];
+                tile.owners &= ~(uint64_t(1) << owners[i]);
+                if (tile.done) { stats_.discardedResults++; continue; }
+
+                const size_t pixels = size_t(tile.job.width) * size_t(tile.job.height);
+                const uint8_t* data = payload.data() + sizeof(result);
+                const size_t size = std::min<size_t>(result.length, payload.size() - sizeof(result));
+                if (result.encoding == TILE_RLE) {
+                    if (!decodeRLE(data, size, decoded, pixels)) return false;
+                } else {
+                    if (size != pixels * 3) return false;
+                    decoded.assign(data, data + size);
+                }
+                for (int row = 0; row < tile.job.height; ++row) {
+                    std::memcpy(&rgb[(size_t(tile.job.y + row) * size_t(width) + size_t(tile.job.x)) * 3],
+                                &decoded[size_t(row) * size_t(tile.job.width) * 3], size_t(tile.job.width) * 3);
+                }
+                tile.done = true;
+                ++doneTiles;
+                stats_.traceMs += result.traceMicroseconds / 1000.0;
+                stats_.rawPixelBytes += pixels * 3;
+                const double tileMs = std::chrono::duration<double, std::milli>(Clock::now() - tile.assignedAt).count();
+                averageTileMs = averageTileMs == 0.0 ? tileMs : averageTileMs * 0.9 + tileMs * 0.1;
+            }
+        }
+        stats_.frameMs = std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count();
+        return true;
+    }
+
+private:
+    struct Worker {
+        int fd;
+        pid_t pid;
+        bool alive;
+        int inFlight;
+    };
+
+    struct Tile {
+        TileJob job;
+        bool done = false;
+        int assignments = 0;
+        uint64_t owners = 0;  // Битовая маска рабочих, считающих плитку сейчас
+        std::chrono::steady_clock::time_point assignedAt;
+    };
+
+    bool send(Worker& worker, uint32_t type, const void* data, size_t size) {
+        stats_.messagesSent++;
+        stats_.bytesSent += sizeof(MessageHeader) + size;
+        return sendMessage(worker.fd, type, data, size);
+    }
+
+    void assign(size_t w, size_t t, std::chrono::steady_clock::time_point now) {
+        Worker& worker = workers_[w];
+        Tile& tile = tiles_[t];
+        if (!send(worker, MSG_TILE_JOB, &tile.job, sizeof(tile.job))) {
+            dropWorker(w);
+            if (tile.owners == 0) retry_.push_back(t);
+            return;
+        }
+        worker.inFlight++;
+        if (tile.assignments++ == 0) tile.assignedAt = now;
+        tile.owners |= uint64_t(1) << w;
+    }
+
+    void dropWorker(size_t w) {
+        workers_[w].alive = false;
+        for (size_t t = 0; t < tiles_.size(); ++t) {
+            Tile& tile = tiles_[t];
+            if (!(tile.owners & (uint64_t(1) << w))) continue;
+            tile.owners &= ~(uint64_t(1) << w);
+            if (!tile.done && tile.owners == 0) {
+                tile.assignments = 0;
+                retry_.push_back(t);
+            }
+        }
+    }
+
+    // Плитка, которую другой рабочий считает заметно дольше среднего: ее дублирует свободный рабочий
+    int pickSlowTile(size_t w, double averageTileMs, std::chrono::steady_clock::time_point now) const {
+        if (averageTileMs <= 0.0) return -1;
+        int best = -1;
+        double bestElapsed = 3.0 * averageTileMs;  // Порог «медленной» плитки
+        for (size_t t = 0; t < tiles_.size(); ++t) {
+            const Tile& tile = tiles_[t];
+            if (tile.done || tile.assignments != 1 || (tile.owners & (uint64_t(1) << w))) continue;
+            double elapsed = std::chrono::duration<double, std::milli>(now - tile.assignedAt).count();
+            if (elapsed > bestElapsed) {
+                bestElapsed = elapsed;
+                best = int(t);
+            }
+        }
+        return best;
+    }
+
+    std::vector<Worker> workers_;
+    std::vector<Tile> tiles_;
+    std::vector<size_t> retry_;  // Плитки упавших рабочих, выдаются в первую очередь
+    std::vector<uint8_t> sceneBytes_;
+    uint32_t frame_ = 0;
+    FrameStats stats_;
+};
@@ -3,123 +3,16 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <vector>
 #include <random>
 #include <cmath>
 
-// Структура луча, содержащая начальную точку (origin) и направление (direction)
-struct Ray {
-    glm::vec3 origin;
-    glm::vec3 direction;
-};
-
-// Структура сферы с методом проверки пересечения
-struct Sphere {
-    glm::vec3 center;  // Центр сферы
-    float radius;      // Радиус сферы
-    glm::vec3 color;   // Цвет сферы
-
-    // Метод проверки пересечения луча с поверхностью сферы
-    bool intersect(const Ray& ray, float& t) const {
-        glm::vec3 oc = ray.origin - center;  // Вектор от центра сферы до начальной точки луча
-        float b = glm::dot(oc, ray.direction);  // Скалярное произведение
-        float c = glm::dot(oc, oc) - radius * radius;  // Уравнение сферы
-        float discriminant = b * b - c;  // Дискриминант для проверки пересечения
-        if (discriminant > 0) {
-            float sqrtDiscriminant = sqrt(discriminant);
-            t = -b - sqrtDiscriminant;  // Ближайшая точка пересечения
-            if (t > 0) return true;
-            t = -b + sqrtDiscriminant;  // Альтернативная точка пересечения
-            return t > 0;
-        }
-        return false;  // Пересечения нет
-    }
-};
-
-// Структура плоскости с методом проверки пересечения
-struct Plane {
-    glm::vec3 point;   // Точка на плоскости
-    glm::vec3 normal;  // Нормаль плоскости
-    glm::vec3 color;   // Цвет плоскости
-
-    // Метод проверки пересечения луча с плоскостью
-    bool intersect(const Ray& ray, float& t) const {
-        float denom = glm::dot(normal, ray.direction);  // Проверка на параллельность
-        if (abs(denom) > 1e-6) {  // Если нормаль не перпендикулярна лучу
-            glm::vec3 p0l0 = point - ray.origin;
-            t = glm::dot(p0l0, normal) / denom;  // Вычисление расстояния до пересечения
-            return (t >= 0);
-        }
-        return false;  // Пересечения нет
-    }
-};
-
-// Структура источника света
-struct Light {
-    glm::vec3 position;  // Позиция света
-    glm::vec3 color;     // Цвет света
-};
-
-// Функция Перлина для создания текстурного шума
-float perlinNoise(const glm::vec3& point) {
-    float n = sin(glm::dot(point, glm::vec3(12.9898f, 78.233f, 45.164f))) * 43758.5453f;
-    return (sin(n) - 1.0f) / 2.0f;  // Возвращает значение шума в диапазоне [-0.5, 0.5]
-}
-
-// Функция трассировки лучей, обрабатывающая пересечения, освещение, отражения и т.д.
-glm::vec3 trace(const Ray& ray, const std::vector<Sphere>& spheres, const std::vector<Plane>& planes, const Light& light, const glm::vec3& viewPos, int depth = 0) {
-    if (depth > 3) return glm::vec3(0.0f);  // Ограничение глубины рекурсии
-
-    float closest_t = std::numeric_limits<float>::max();  // Ближайшее пересечение
-    glm::vec3 closest_color = glm::vec3(0.0f);  // Цвет объекта пересечения
-    glm::vec3 hitPoint;  // Точка пересечения
-    glm::vec3 normal;    // Нормаль поверхности в точке пересечения
-    bool hit = false;    // Флаг пересечения
-
-    // Проверка пересечения со сферами
-    for (const Sphere& sphere : spheres) {
-        float t;
-        if (sphere.intersect(ray, t) && t < closest_t) {
-            closest_t = t;
-            hit = true;
-            hitPoint = ray.origin + t * ray.direction;  // Вычисление точки пересечения
-            normal = glm::normalize(hitPoint - sphere.center);  // Нормаль к поверхности
-            closest_color = sphere.color;
-
-            // Применение текстурного шума Перлина
-            float noise = perlinNoise(hitPoint);
-            closest_color = closest_color * (0.5f + 0.5f * noise);
-        }
-    }
-
-    // Проверка пересечения с плоскостями
-    for (const Plane& plane : planes) {
-        float t;
-        if (plane.intersect(ray, t) && t < closest_t) {
-            closest_t = t;
-            hit = true;
-            hitPoint = ray.origin + t * ray.direction;  // Вычисление точки пересечения
-            normal = plane.normal;  // Нормаль к поверхности
-            closest_color = plane.color;
-        }
-    }
-
-    if (!hit) return glm::vec3(0.0f);  // Если пересечений нет, возвращаем черный цвет
-
-    // Вычисление амбиентного и диффузного освещения
-    glm::vec3 ambient = 0.1f * closest_color;  // Амбиентное освещение
-    glm::vec3 lightDir = glm::normalize(light.position - hitPoint);  // Направление на источник света
-    float diff = glm::max(glm::dot(normal, lightDir), 0.0f);  // Диффузная компонента
-    glm::vec3 diffuse = diff * closest_color;
-
-    // Логика отражения
-    glm::vec3 reflectDir = glm::normalize(glm::reflect(ray.direction, normal));  // Направление отраженного луча
-    Ray reflectRay = { hitPoint + normal * 0.001f, reflectDir };  // Смещение начальной точки отражения
-    glm::vec3 reflectColor = trace(reflectRay, spheres, planes, light, viewPos, depth + 1);  // Рекурсивная трассировка
-
-    return ambient + diffuse + 0.5f * reflectColor;  // Суммируем компоненты освещения
-}
+#include "distributed.h"
+#include "tracer.h"
 
 // Функция рендера сцены
 void renderScene(const std::vector<Sphere>& spheres, const std::vector<Plane>& planes, const Light& light, const glm::vec3& viewPos, int width, int height) {
@@ -146,6 +39,18 @@ void renderScene(const std::vector<Sphere>& spheres, const std::vector<Plane>& p
     glFlush();
 }
 
+// Отображение кадра, собранного из плиток рабочих процессов (RGB8, строка 0 — нижняя)
+void drawFrame(const std::vector<uint8_t>& rgb, int width, int height) {
+    glClear(GL_COLOR_BUFFER_BIT);
+    glBegin(GL_POINTS);
+    for (int i = 0; i < width * height; ++i) {
+        glColor3ub(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]);  // Цвет пикселя
+        glVertex2f((i % width) / float(width) * 2.0f - 1.0f, (i / width) / float(height) * 2.0f - 1.0f);
+    }
+    glEnd();
+    glFlush();
+}
+
 // Обработка ввода для перемещения источника света
 void processInput(GLFWwindow* window, Light& light, float deltaTime) {
     const float movementSpeed = 5.0f;
@@ -174,40 +79,121 @@ void processInput(GLFWwindow* window, Light& light, float deltaTime) {
     light.position += (targetPosition - light.position) * smoothFactor;  // Плавное перемещение
 }
 
-// Основная функция
-int main() {
-    // Инициализация GLFW и OpenGL
-    if (!glfwInit()) return -1;
-    GLFWwindow* window = glfwCreateWindow(800, 600, "Ray Tracing with New Colors", NULL, NULL);
-    if (!window) {
-        glfwTerminate();
-        return -1;
-    }
-    glfwMakeContextCurrent(window);
-    glewInit();
+// Сцена лабораторной: три сферы, плоскость, источник света и камера
+Scene createScene() {
+    Scene scene;
 
     // Создание сфер
-    std::vector<Sphere> spheres = {
+    scene.spheres = {
         { glm::vec3(0.0f, 0.0f, -3.0f), 1.0f, glm::vec3(1.0f, 1.0f, 0.0f) },  // Желтая сфера
         { glm::vec3(2.0f, 0.0f, -3.0f), 1.0f, glm::vec3(0.0f, 0.8f, 0.8f) },  // Голубая сфера
         { glm::vec3(-2.0f, 0.0f, -3.0f), 1.0f, glm::vec3(0.9f, 0.0f, 0.9f) }  // Розовая сфера
     };
 
     // Создание плоскости
-    std::vector<Plane> planes = {
+    scene.planes = {
         { glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.5f, 0.5f, 0.5f) }  // Серая плоскость
     };
 
     // Источник света
-    Light light = { glm::vec3(3.0f, 2.0f, -2.0f), glm::vec3(1.0f, 1.0f, 0.0f) };  // Желтый свет
-    glm::vec3 viewPos(0.0f, 0.0f, 3.0f);  // Позиция камеры
+    scene.light = { glm::vec3(3.0f, 2.0f, -2.0f), glm::vec3(1.0f, 1.0f, 0.0f) };  // Желтый свет
+    scene.viewPos = glm::vec3(0.0f, 0.0f, 3.0f);  // Позиция камеры
+    return scene;
+}
+
+// Замер распределенного рендеринга без окна: ./app --bench-distributed.
+// Кадр каждой конфигурации сверяется побайтно с кадром, посчитанным в одном процессе.
+int runDistributedBenchmark() {
+    const int width = 800, height = 600, tileSize = 32, frames = 3;
+    Scene scene = createScene();
+    bool ok = true;
+
+    std::vector<uint8_t> reference;
+    auto start = std::chrono::steady_clock::now();
+    traceTile(scene, width, height, 0, 0, width, height, reference);
+    double singleMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "single process: " << singleMs << " ms/frame, " << reference.size() << " bytes of RGB8" << std::endl;
+
+    auto run = [&](int workers, int slowWorkerDelayMs) {
+        RenderCoordinator coordinator;
+        if (!coordinator.start(workers, slowWorkerDelayMs)) {
+            std::cout << "Failed to start " << workers << " workers" << std::endl;
+            ok = false;
+            return;
+        }
+        std::vector<uint8_t> rgb;
+        double frameMs = 0.0, traceMs = 0.0;
+        size_t sent = 0, received = 0, raw = 0, reassigned = 0, discarded = 0, sceneUploads = 0;
+        bool match = true;
+        for (int f = 0; f < frames; ++f) {
+            match = coordinator.renderFrame(scene, width, height, tileSize, rgb) && rgb == reference && match;
+            const RenderCoordinator::FrameStats& stats = coordinator.stats();
+            frameMs += stats.frameMs;
+            traceMs += stats.traceMs;
+            sent += stats.bytesSent;
+            received += stats.bytesReceived;
+            raw += stats.rawPixelBytes;
+            reassigned += stats.reassignedTiles;
+            discarded += stats.discardedResults;
+            sceneUploads += stats.sceneUploads;
+        }
+        ok = ok && match;
+        frameMs /= frames;
+        traceMs /= frames;
+        // Накладные расходы: время кадра сверх идеального деления трассировки между рабочими
+        const double overheadMs = frameMs - traceMs / workers;
+        std::cout << workers << " workers" << (slowWorkerDelayMs > 0 ? " (worker 0 slowed)" : "") << ": " << frameMs
+                  << " ms/frame, speedup " << singleMs / frameMs << "x, overhead " << overheadMs << " ms/frame; sent "
+                  << sent / frames << " B/frame, received " << received / frames << " B/frame (raw pixels "
+                  << raw / frames << " B, ratio " << double(raw) / double(std::max<size_t>(received, 1)) << "x); scene uploads "
+                  << sceneUploads << " in " << frames << " frames; reassigned " << reassigned << ", discarded " << discarded
+                  << "; frame " << (match ? "matches" : "MISMATCH") << std::endl;
+    };
+
+    for (int workers : {1, 2, 4, 8}) run(workers, 0);
+    run(4, 20);  // Медленный рабочий: его плитки должны уйти остальным
+    return ok ? 0 : 1;
+}
+
+// Основная функция
+int main(int argc, char** argv) {
+    // --workers N: трассировка в N рабочих процессах; --bench-distributed: замер без окна
+    int workerCount = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--bench-distributed") == 0) return runDistributedBenchmark();
+        if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc) workerCount = std::atoi(argv[++i]);
+    }
+
+    Scene scene = createScene();
+
+    // Рабочие процессы создаются до окна, чтобы они не наследовали контекст OpenGL
+    RenderCoordinator coordinator;
+    if (workerCount > 0 && !coordinator.start(workerCount)) {
+        std::cout << "Failed to start " << workerCount << " workers" << std::endl;
+        return -1;
+    }
+    std::vector<uint8_t> frame;  // Кадр от рабочих процессов
+
+    // Инициализация GLFW и OpenGL
+    if (!glfwInit()) return -1;
+    GLFWwindow* window = glfwCreateWindow(800, 600, "Ray Tracing with New Colors", NULL, NULL);
+    if (!window) {
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    glewInit();
 
     while (!glfwWindowShouldClose(window)) {
         float deltaTime = glfwGetTime();  // Вычисление времени между кадрами
         glfwSetTime(0.0);
 
-        processInput(window, light, deltaTime);  // Обработка ввода
-        renderScene(spheres, planes, light, viewPos, 800, 600);  // Рендер сцены
+        processInput(window, scene.light, deltaTime);  // Обработка ввода
+        if (coordinator.workerCount() > 0 && coordinator.renderFrame(scene, 800, 600, 32, frame)) {
+            drawFrame(frame, 800, 600);  // Кадр собран из плиток рабочих процессов
+        } else {
+            renderScene(scene.spheres, scene.planes, scene.light, scene.viewPos, 800, 600);  // Рендер сцены
+        }
 
         glfwSwapBuffers(window);  // Обновление окна
         glfwPollEvents();  // Обработка событий
@@ -216,5 +202,3 @@ int main() {
     glfwTerminate();  // Завершение работы GLFW
     return 0;
 }
-
-
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Структура луча, содержащая начальную точку (origin) и направление (direction)
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+};
+
+// Структура сферы с методом проверки пересечения
+struct Sphere {
+    glm::vec3 center;  // Центр сферы
+    float radius;      // Радиус сферы
+    glm::vec3 color;   // Цвет сферы
+
+    // Метод проверки пересечения луча с поверхностью сферы
+    bool intersect(const Ray& ray, float& t) const {
+        glm::vec3 oc = ray.origin - center;  // Вектор от центра сферы до начальной точки луча
+        float b = glm::dot(oc, ray.direction);  // Скалярное произведение
+        float c = glm::dot(oc, oc) - radius * radius;  // Уравнение сферы
+        float discriminant = b * b - c;  // Дискриминант для проверки пересечения
+        if (discriminant > 0) {
+            float sqrtDiscriminant = sqrt(discriminant);
+            t = -b - sqrtDiscriminant;  // Ближайшая точка пересечения
+            if (t > 0) return true;
+            t = -b + sqrtDiscriminant;  // Альтернативная точка пересечения
+            return t > 0;
+        }
+        return false;  // Пересечения нет
+    }
+};
+
+// Структура плоскости с методом проверки пересечения
+struct Plane {
+    glm::vec3 point;   // Точка на плоскости
+    glm::vec3 normal;  // Нормаль плоскости
+    glm::vec3 color;   // Цвет плоскости
+
+    // Метод проверки пересечения луча с плоскостью
+    bool intersect(const Ray& ray, float& t) const {
+        float denom = glm::dot(normal, ray.direction);  // Проверка на параллельность
+        if (abs(denom) > 1e-6) {  // Если нормаль не перпендикулярна лучу
+            glm::vec3 p0l0 = point - ray.origin;
+            t = glm::dot(p0l0, normal) / denom;  // Вычисление расстояния до пересечения
+            return (t >= 0);
+        }
+        return false;  // Пересечения нет
+    }
+};
+
+// Структура источника света
+struct Light {
+    glm::vec3 position;  // Позиция света
+    glm::vec3 color;     // Цвет света
+};
+
+// Функция Перлина для создания текстурного шума
+inline float perlinNoise(const glm::vec3& point) {
+    float n = sin(glm::dot(point, glm::vec3(12.9898f, 78.233f, 45.164f))) * 43758.5453f;
+    return (sin(n) - 1.0f) / 2.0f;  // Возвращает значение шума в диапазоне [-0.5, 0.5]
+}
+
+// Функция трассировки лучей, обрабатывающая пересечения, освещение, отражения и т.д.
+inline glm::vec3 trace(const Ray& ray, const std::vector<Sphere>& spheres, const std::vector<Plane>& planes, const Light& light, const glm::vec3& viewPos, int depth = 0) {
+    if (depth > 3) return glm::vec3(0.0f);  // Ограничение глубины рекурсии
+
+    float closest_t = std::numeric_limits<float>::max();  // Ближайшее пересечение
+    glm::vec3 closest_color = glm::vec3(0.0f);  // Цвет объекта пересечения
+    glm::vec3 hitPoint;  // Точка пересечения
+    glm::vec3 normal;    // Нормаль поверхности в точке пересечения
+    bool hit = false;    // Флаг пересечения
+
+    // Проверка пересечения со сферами
+    for (const Sphere& sphere : spheres) {
+        float t;
+        if (sphere.intersect(ray, t) && t < closest_t) {
+            closest_t = t;
+            hit = true;
+            hitPoint = ray.origin + t * ray.direction;  // Вычисление точки пересечения
+            normal = glm::normalize(hitPoint - sphere.center);  // Нормаль к поверхности
+            closest_color = sphere.color;
+
+            // Применение текстурного шума Перлина
+            float noise = perlinNoise(hitPoint);
+            closest_color = closest_color * (0.5f + 0.5f * noise);
+        }
+    }
+
+    // Проверка пересечения с плоскостями
+    for (const Plane& plane : planes) {
+        float t;
+        if (plane.intersect(ray, t) && t < closest_t) {
+            closest_t = t;
+            hit = true;
+            hitPoint = ray.origin + t * ray.direction;  // Вычисление точки пересечения
+            normal = plane.normal;  // Нормаль к поверхности
+            closest_color = plane.color;
+        }
+    }
+
+    if (!hit) return glm::vec3(0.0f);  // Если пересечений нет, возвращаем черный цвет
+
+    // Вычисление амбиентного и диффузного освещения
+    glm::vec3 ambient = 0.1f * closest_color;  // Амбиентное освещение
+    glm::vec3 lightDir = glm::normalize(light.position - hitPoint);  // Направление на источник света
+    float diff = glm::max(glm::dot(normal, lightDir), 0.0f);  // Диффузная компонента
+    glm::vec3 diffuse = diff * closest_color;
+
+    // Логика отражения
+    glm::vec3 reflectDir = glm::normalize(glm::reflect(ray.direction, normal));  // Направление отраженного луча
+    Ray reflectRay = { hitPoint + normal * 0.001f, reflectDir };  // Смещение начальной точки отражения
+    glm::vec3 reflectColor = trace(reflectRay, spheres, planes, light, viewPos, depth + 1);  // Рекурсивная трассировка
+
+    return ambient + diffuse + 0.5f * reflectColor;  // Суммируем компоненты освещения
+}
+
+// Сцена целиком: то, что координатор один раз передает рабочим процессам
+struct Scene {
+    std::vector<Sphere> spheres;
+    std::vector<Plane> planes;
+    Light light;
+    glm::vec3 viewPos;
+};
+
+// Цвет пикселя (x, y) кадра width x height; строка 0 — нижняя, как в renderScene
+inline glm::vec3 tracePixel(const Scene& scene, int x, int y, int width, int height) {
+    float u = (x + 0.5f) / float(width) * 2.0f - 1.0f;  // Нормализованные координаты
+    float v = (y + 0.5f) / float(height) * 2.0f - 1.0f;
+    Ray ray = { scene.viewPos, glm::normalize(glm::vec3(u, v, -1.0f)) };  // Создание луча
+    return trace(ray, scene.spheres, scene.planes, scene.light, scene.viewPos);
+}
+
+inline uint8_t colorToByte(float c) {
+    return uint8_t(std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f));
+}
+
+// Трассировка прямоугольной плитки в RGB8 (по строкам, снизу вверх)
+inline void traceTile(const Scene& scene, int width, int height, int x0, int y0, int tileWidth, int tileHeight, std::vector<uint8_t>& rgb) {
+    rgb.resize(size_t(tileWidth) * size_t(tileHeight) * 3);
+    for (int y = 0; y < tileHeight; ++y) {
+        for (int x = 0; x < tileWidth; ++x) {
+            glm::vec3 color = tracePixel(scene, x0 + x, y0 + y, width, height);
+            uint8_t* out = &rgb[(size_t(y) * size_t(tileWidth) + size_t(x)) * 3];
+            out[0] = colorToByte(color.r);
+            out[1] = colorToByte(color.g);
+            out[2] = colorToByte(color.b);
+        }
+    }
+}